@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.af"
+
+#include "AfFollower.h"
+#include "SignalMonitor.h"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace std::chrono_literals;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+
+// PAMD levels, same scale as PAMD_DB_TBL of COM_active_af (8 ~ 5dB, 12 ~ 10dB, 15 ~ 15dB)
+static constexpr int kPamdDegraded = 15;  // below: start checking candidates
+static constexpr int kPamdSwitch = 8;     // below: leave the channel for a good AF
+static constexpr int kPamdGoodAf = 12;    // an AF worth switching to
+static constexpr int kPamdMargin = 3;     // and clearly better than the current channel
+
+static constexpr auto kCheckSettle = 40ms;     // PAMD settle time after tune-away
+static constexpr auto kCheckInterval = 2s;     // at most one muted gap per interval
+static constexpr auto kCheckValidity = 30s;    // older measurements don't justify a switch
+static constexpr size_t kAfMax = sizeof(AF_Info::AF[0]) / sizeof(AF_Info::AF[0][0]);
+
+void AfFollower::reset(uint16_t freq) {
+    mFreq = freq;
+    mCandidates.clear();
+    mDriverHint = false;
+    mPamd = -1;
+    mDegraded = false;
+}
+
+void AfFollower::update(const RDSData_Struct& rds, uint16_t events) {
+    if (events & RDS_EVENT_AF) {
+        mDriverHint = true;
+    }
+    if (!(events & RDS_EVENT_AF_LIST)) return;
+
+    size_t num = std::min<size_t>(std::max<int16_t>(rds.AF_Data.AF_Num, 0), kAfMax);
+    std::vector<Candidate> candidates;
+    candidates.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+        uint16_t freq = rds.AF_Data.AF[1][i];  // method A or B
+        if (freq == 0 || freq == mFreq) continue;
+        auto known = std::find_if(mCandidates.begin(), mCandidates.end(),
+                                  [freq](const Candidate& c) { return c.freq == freq; });
+        candidates.push_back(known != mCandidates.end() ? *known : Candidate{freq, -1, {}});
+    }
+    mCandidates = std::move(candidates);
+    rank();
+    ALOGD("AF list of %u: %zu candidates", mFreq, mCandidates.size());
+}
+
+uint16_t AfFollower::poll(uint16_t freq, int pamd) {
+    if (!mEnabled || freq != mFreq || pamd < 0) return 0;
+
+    auto now = Clock::now();
+    mPamd = pamd;
+    if (pamd >= kPamdDegraded) {
+        // a weak-signal hint of the driver is stale once the channel is clean again
+        mDriverHint = false;
+        mDegraded = false;
+        return 0;
+    }
+    if (!mDegraded) {
+        mDegraded = true;
+        mDegradedAt = now;
+        ALOGD("%u degraded, pamd %d", mFreq, pamd);
+    }
+    if (mCandidates.empty()) return 0;
+
+    bool mustSwitch = pamd < kPamdSwitch || mDriverHint;
+    auto pickSwitch = [&]() -> uint16_t {
+        const Candidate& best = mCandidates.front();
+        if (best.pamd < kPamdGoodAf || best.pamd < pamd + kPamdMargin) return 0;
+        if (Clock::now() - best.checkedAt > kCheckValidity) return 0;
+        return best.freq;
+    };
+
+    if (mustSwitch) {
+        if (auto to = pickSwitch()) return to;
+    }
+    if (now - mLastCheck < kCheckInterval) return 0;
+
+    // never checked ones have the epoch as checkedAt, so they go first
+    auto stalest = std::min_element(
+        mCandidates.begin(), mCandidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.checkedAt < b.checkedAt; });
+    check(*stalest);
+    rank();
+
+    return mustSwitch ? pickSwitch() : 0;
+}
+
+void AfFollower::onSwitched(uint16_t freq, milliseconds dropout) {
+    auto latency = duration_cast<milliseconds>(Clock::now() - mDegradedAt);
+    mStats.switches++;
+    mStats.lastSwitchLatency = latency;
+    mStats.lastSwitchDropout = dropout;
+    ALOGI("AF switch %u -> %u, latency %lldms, dropout %lldms", mFreq, freq,
+          static_cast<long long>(latency.count()), static_cast<long long>(dropout.count()));
+
+    // the channel we leave stays an alternative of the new one
+    for (auto& c : mCandidates) {
+        if (c.freq != freq) continue;
+        c.freq = mFreq;
+        c.pamd = mPamd;
+        c.checkedAt = Clock::now();
+        break;
+    }
+    rank();
+    mFreq = freq;
+    mPamd = -1;
+    mDriverHint = false;
+    mDegraded = false;
+}
+
+void AfFollower::check(Candidate& candidate) {
+    auto start = Clock::now();
+
+    // keep rds and signal samples of the candidate out of the tuned station,
+    // like COM_active_af does for rds
+    getSignalMonitor().pause();
+    setRds(false);
+    setMute(true);
+    tune(candidate.freq * 10);
+    std::this_thread::sleep_for(kCheckSettle);
+    candidate.pamd = getPamd();
+    tune(mFreq * 10);
+    setMute(false);
+    setRds(true);
+    getSignalMonitor().resume();
+
+    auto end = Clock::now();
+    auto dropout = duration_cast<milliseconds>(end - start);
+    candidate.checkedAt = end;
+    mLastCheck = end;
+    mStats.checks++;
+    mStats.lastCheckDropout = dropout;
+    mStats.maxCheckDropout = std::max(mStats.maxCheckDropout, dropout);
+    FMR_TRACE(TR_AF_CHECK, candidate.freq, candidate.pamd, dropout.count());
+}
+
+void AfFollower::rank() {
+    std::stable_sort(mCandidates.begin(), mCandidates.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.pamd > b.pamd; });
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_AFFOLLOWER_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_AFFOLLOWER_H
+
+#include "fmr.h"
+
+#include <chrono>
+#include <vector>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/**
+ * Follows rds alternative frequencies of the tuned station in the background.
+ *
+ * Replaces the blocking COM_active_af sweep: AF candidates are kept ranked by the
+ * PAMD last measured on them, and while the current channel degrades one candidate
+ * at a time is checked with a short muted tune-away. Once the current channel is bad
+ * enough the best fresh candidate is returned, so the caller switches with one tune.
+ *
+ * Frequencies are in driver units (10kHz, Eg. 8750). Not thread safe, the owner
+ * serializes calls.
+ */
+class AfFollower {
+   public:
+    struct Stats {
+        uint32_t checks = 0;
+        uint32_t switches = 0;
+        std::chrono::milliseconds lastCheckDropout{0};
+        std::chrono::milliseconds maxCheckDropout{0};
+        std::chrono::milliseconds lastSwitchLatency{0};  // degraded -> tuned to the AF
+        std::chrono::milliseconds lastSwitchDropout{0};  // time spent in the switch tune
+    };
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+    uint16_t freq() const { return mFreq; }
+
+    /** Starts over for a station tuned by the client, AFs of the previous one don't apply. */
+    void reset(uint16_t freq);
+
+    /** Takes the AF list out of an rds snapshot, when events say it changed. */
+    void update(const RDSData_Struct& rds, uint16_t events);
+
+    /**
+     * Runs one round: may check one candidate on the chip.
+     * @Result: AF to switch to, 0 to stay on freq.
+     */
+    uint16_t poll(uint16_t freq, int pamd);
+
+    /** Reports the caller tuned to the AF returned by poll, dropout is the tune duration. */
+    void onSwitched(uint16_t freq, std::chrono::milliseconds dropout);
+
+    const Stats& stats() const { return mStats; }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Candidate {
+        uint16_t freq;
+        int pamd;  // -1 until checked
+        Clock::time_point checkedAt;
+    };
+
+    bool mEnabled = false;
+    uint16_t mFreq = 0;
+    std::vector<Candidate> mCandidates;  // best measured first
+    bool mDriverHint = false;  // driver raised RDS_EVENT_AF
+    int mPamd = -1;            // of mFreq, from the last poll
+    bool mDegraded = false;
+    Clock::time_point mDegradedAt;
+    Clock::time_point mLastCheck;
+    Stats mStats;
+
+    void check(Candidate& candidate);
+    void rank();
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_AFFOLLOWER_H
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.announce"
+
+#include "AnnouncementEngine.h"
+
+#include <broadcastradio-utils-2x/Utils.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace android::hardware::broadcastradio;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::lock_guard;
+using std::mutex;
+
+static constexpr size_t kAfMax = sizeof(AF_Info::AF[0]) / sizeof(AF_Info::AF[0][0]);
+
+constexpr milliseconds AnnouncementEngine::kLatencyTarget;
+
+class AnnouncementEngine::CloseHandle : public ICloseHandle {
+   public:
+    CloseHandle(AnnouncementEngine& engine, uint64_t id) : mEngine(engine), mId(id) {}
+
+    Return<void> close() override {
+        // a second close is a no-op
+        if (!mClosed.exchange(true)) mEngine.unregister(mId);
+        return {};
+    }
+
+   private:
+    AnnouncementEngine& mEngine;
+    const uint64_t mId;
+    std::atomic<bool> mClosed{false};
+};
+
+sp<ICloseHandle> AnnouncementEngine::registerListener(const hidl_vec<AnnouncementType>& enabled,
+                                                      const sp<IAnnouncementListener>& listener) {
+    // rds only tells about traffic
+    if (std::find(enabled.begin(), enabled.end(), AnnouncementType::TRAFFIC) == enabled.end()) {
+        return nullptr;
+    }
+
+    lock_guard<mutex> lk(mMut);
+    uint64_t id = mNextId++;
+    mListeners.push_back({id, listener});
+    if (mTa || !mEon.empty()) {
+        listener->onListUpdated(listLocked());
+    }
+    ALOGD("listener %llu registered, %zu in total", static_cast<unsigned long long>(id),
+          mListeners.size());
+    return new CloseHandle(*this, id);
+}
+
+void AnnouncementEngine::unregister(uint64_t id) {
+    lock_guard<mutex> lk(mMut);
+    mListeners.erase(std::remove_if(mListeners.begin(), mListeners.end(),
+                                    [id](const Listener& l) { return l.id == id; }),
+                     mListeners.end());
+    ALOGD("listener %llu closed", static_cast<unsigned long long>(id));
+}
+
+void AnnouncementEngine::reset(uint64_t freq) {
+    lock_guard<mutex> lk(mMut);
+    if (freq == mFreq) return;
+    bool wasActive = mTa || !mEon.empty();
+    mFreq = freq;
+    mPi = 0;
+    mTa = false;
+    mEon.clear();
+    if (wasActive) notifyLocked(nullptr);
+}
+
+void AnnouncementEngine::update(const RDSData_Struct& rds, uint16_t events,
+                                Clock::time_point arrived) {
+    if (!(events & (RDS_EVENT_PI_CODE | RDS_EVENT_FLAGS | RDS_EVENT_TAON | RDS_EVENT_TAON_OFF))) {
+        return;
+    }
+
+    lock_guard<mutex> lk(mMut);
+    if (mFreq == 0) return;
+    bool changed = false;
+
+    if (events & RDS_EVENT_PI_CODE) {
+        changed |= mTa && mPi != rds.PI;
+        mPi = rds.PI;
+    }
+    if (events & RDS_EVENT_FLAGS) {
+        // TA without TP only means the station carries EON info about others
+        bool ta = rds.RDSFlag.TP && rds.RDSFlag.TA;
+        changed |= ta != mTa;
+        mTa = ta;
+    }
+    if (events & RDS_EVENT_TAON) {
+        std::vector<uint64_t> eon;
+        size_t num = std::min<size_t>(std::max<int16_t>(rds.AFON_Data.AF_Num, 0), kAfMax);
+        for (size_t i = 0; i < num; i++) {
+            uint64_t freq = rds.AFON_Data.AF[1][i] * 10;
+            if (freq != 0 && freq != mFreq) eon.push_back(freq);
+        }
+        changed |= eon != mEon;
+        mEon = std::move(eon);
+    } else if (events & RDS_EVENT_TAON_OFF) {
+        changed |= !mEon.empty();
+        mEon.clear();
+    }
+
+    if (changed) notifyLocked(&arrived);
+}
+
+AnnouncementEngine::Stats AnnouncementEngine::stats() const {
+    lock_guard<mutex> lk(mMut);
+    return mStats;
+}
+
+hidl_vec<Announcement> AnnouncementEngine::listLocked() const {
+    std::vector<Announcement> list;
+    if (mTa) {
+        Announcement a = {};
+        a.selector = utils::make_selector_amfm(mFreq);
+        if (mPi != 0) {
+            a.selector.secondaryIds = hidl_vec<ProgramIdentifier>(
+                {utils::make_identifier(IdentifierType::RDS_PI, mPi)});
+        }
+        a.type = AnnouncementType::TRAFFIC;
+        list.push_back(a);
+    }
+    for (auto freq : mEon) {
+        Announcement a = {};
+        a.selector = utils::make_selector_amfm(freq);
+        a.type = AnnouncementType::TRAFFIC;
+        list.push_back(a);
+    }
+    return hidl_vec<Announcement>(list.begin(), list.end());
+}
+
+// arrived is null for changes of our own, like a tune, nothing to measure then
+void AnnouncementEngine::notifyLocked(const Clock::time_point* arrived) {
+    auto list = listLocked();
+    ALOGI("%zu traffic announcements on air (ta %d, eon %zu)", list.size(), mTa, mEon.size());
+
+    // listener calls are oneway, a dead one is dropped
+    mListeners.erase(std::remove_if(mListeners.begin(), mListeners.end(),
+                                    [&list](const Listener& l) {
+                                        return !l.listener->onListUpdated(list).isOk();
+                                    }),
+                     mListeners.end());
+
+    if (arrived == nullptr) return;
+    auto latency = duration_cast<milliseconds>(Clock::now() - *arrived);
+    mStats.notified++;
+    mStats.lastLatency = latency;
+    mStats.maxLatency = std::max(mStats.maxLatency, latency);
+    if (latency > kLatencyTarget) {
+        mStats.late++;
+        ALOGW("announcement notified %lldms after the rds event",
+              static_cast<long long>(latency.count()));
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
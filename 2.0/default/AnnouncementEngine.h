@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_ANNOUNCEMENTENGINE_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_ANNOUNCEMENTENGINE_H
+
+#include "fmr.h"
+
+#include <android/hardware/broadcastradio/2.0/IAnnouncementListener.h>
+#include <android/hardware/broadcastradio/2.0/ICloseHandle.h>
+#include <android/hardware/broadcastradio/2.0/types.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace ::android::hardware::broadcastradio::V2_0;
+using ::android::sp;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+
+/**
+ * Traffic announcements of the tuned station and of the programs it links by EON.
+ *
+ * Fed by the rds reader with every rds read: TA on the tuned station follows the
+ * TP/TA flags, EON ones follow RDS_EVENT_TAON/RDS_EVENT_TAON_OFF and the AFON list.
+ * Listeners get the full list of active announcements on each change, from the
+ * thread that read the rds data. The time from the driver having the data to the
+ * notification is tracked against kLatencyTarget.
+ *
+ * Thread safe: the rds thread feeds it, binder threads register listeners.
+ */
+class AnnouncementEngine {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kLatencyTarget{200};
+
+    struct Stats {
+        uint32_t notified = 0;  // list changes sent out
+        uint32_t late = 0;      // of them, over kLatencyTarget
+        std::chrono::milliseconds lastLatency{0};
+        std::chrono::milliseconds maxLatency{0};
+    };
+
+    /**
+     * @Result: handle whose close() unregisters the listener, nullptr when none of
+     * the enabled types can be detected.
+     */
+    sp<ICloseHandle> registerListener(const hidl_vec<AnnouncementType>& enabled,
+                                      const sp<IAnnouncementListener>& listener);
+
+    /** The tuner moved to freq (kHz), 0 once closed: whatever was on air is over. */
+    void reset(uint64_t freq);
+
+    /** One rds read of the tuned station, arrived is when the driver had it ready. */
+    void update(const RDSData_Struct& rds, uint16_t events, Clock::time_point arrived);
+
+    Stats stats() const;
+
+   private:
+    struct Listener {
+        uint64_t id;
+        sp<IAnnouncementListener> listener;
+    };
+    class CloseHandle;
+
+    mutable std::mutex mMut;
+    std::vector<Listener> mListeners;
+    uint64_t mNextId = 1;
+    uint64_t mFreq = 0;
+    uint16_t mPi = 0;
+    bool mTa = false;            // tuned station is in an announcement
+    std::vector<uint64_t> mEon;  // kHz of linked programs in an announcement
+    Stats mStats;
+
+    void unregister(uint64_t id);
+    hidl_vec<Announcement> listLocked() const;
+    void notifyLocked(const Clock::time_point* arrived);
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_ANNOUNCEMENTENGINE_H
@@ -14,12 +14,13 @@
  * limitations under the License.
  */
 #define LOG_TAG "BcRadioDef.module"
-#define LOG_NDEBUG 0
 
 #include "BroadcastRadio.h"
 
 #include <log/log.h>
 
+#include <chrono>
+
 #include "resources.h"
 
 namespace vendor {
@@ -34,70 +35,87 @@ using std::map;
 using std::mutex;
 using std::vector;
 
-static const AmFmRegionConfig gDefaultAmFmConfig = {  //
-    {
-        {87500, 108000, 100, 100},  // FM
-        {153, 282, 3, 9},           // AM LW
-        {531, 1620, 9, 9},          // AM MW
-        {1600, 30000, 1, 5},        // AM SW
-    },
-    static_cast<uint32_t>(Deemphasis::D50),
-    static_cast<uint32_t>(Rds::RDS)};
-
-static Properties initProperties(const VirtualRadio& virtualRadio) {
-    Properties prop = {};
-
-    prop.maker = "Google";
-    prop.product = virtualRadio.getName();
-    prop.supportedIdentifierTypes = hidl_vec<uint32_t>({
-        static_cast<uint32_t>(IdentifierType::AMFM_FREQUENCY),
-        static_cast<uint32_t>(IdentifierType::RDS_PI),
-        static_cast<uint32_t>(IdentifierType::HD_STATION_ID_EXT),
-    });
-    prop.vendorInfo = hidl_vec<VendorKeyValue>({
-        {"com.google.dummy", "dummy"},
-    });
+// tuner state kept across sessions, see the post-fs-data mkdir in the rc file
+static constexpr char kJournalPath[] = "/data/vendor/fmradio/tuner.journal";
 
-    return prop;
-}
+// station logos, "<pi in hex>.png"
+static constexpr char kLogoDir[] = "/vendor/etc/fmradio/logos";
+static constexpr size_t kMaxMappedLogos = 4 * 1024 * 1024;
 
 BroadcastRadio::BroadcastRadio(const VirtualRadio& virtualRadio)
     : mVirtualRadio(virtualRadio),
-      mProperties(initProperties(virtualRadio)),
-      mAmFmConfig(gDefaultAmFmConfig) {
+      mJournal(kJournalPath),
+      mImages(kLogoDir, kMaxMappedLogos),
+      mConfigWatcher(FMR_CONFIG_OVERRIDE_FILE, []() {
+          // band and the like need a restart, only thresholds are taken on the fly
+          if (!reloadTunables()) ALOGW("%s rejected, thresholds kept", FMR_CONFIG_OVERRIDE_FILE);
+      }) {
+    CUST_cfg_ds cfg = {};
+    readConfig(&cfg);
+    publishConfig(makeRadioConfig(cfg, virtualRadio.getName()));
+    mConfigWatcher.start();
+}
 
-      }
 BroadcastRadio::~BroadcastRadio(){
+    mConfigWatcher.stop();
+    if (mWarmThread.joinable()) mWarmThread.join();
+}
+
+void BroadcastRadio::prewarm() {
+    ALOGI("%s", __func__);
+    mWarmThread = std::thread([this]() {
+        auto start = std::chrono::steady_clock::now();
+        bool opened = openDev();
+        bool rds = opened && isRdsSupported();
+        auto parked = std::make_unique<ParkedThread>();
+
+        lock_guard<mutex> lk(mWarmMut);
+        mIsWarm = opened;
+        mParkedThread = std::move(parked);
+        ALOGI("prewarm done in %lldms, opened:%d rds:%d",
+              static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count()),
+              opened, rds);
+    });
+}
+
+bool BroadcastRadio::isRdsSupported() {
+    lock_guard<mutex> lk(mWarmMut);
+    if (mRdsSupport < 0) {
+        int supt = isRdsSupport();
+        if (supt < 0) return false;  // probe failed, try again next time
+        mRdsSupport = supt;
+    }
+    return mRdsSupport == 1;
+}
+
+std::unique_ptr<ParkedThread> BroadcastRadio::takeParkedThread() {
+    lock_guard<mutex> lk(mWarmMut);
+    if (mParkedThread != nullptr) return std::move(mParkedThread);
+    return std::make_unique<ParkedThread>();
 }
 
 Return<void> BroadcastRadio::getProperties(getProperties_cb _hidl_cb) {
     ALOGV("%s", __func__);
-    _hidl_cb(mProperties);
+    _hidl_cb(config()->properties);
     return {};
 }
 
-AmFmRegionConfig BroadcastRadio::getAmFmConfig() const {
-    lock_guard<mutex> lk(mMut);
-    return mAmFmConfig;
+std::shared_ptr<const RadioConfig> BroadcastRadio::config() const {
+    return std::atomic_load(&mConfig);
+}
+
+void BroadcastRadio::publishConfig(std::shared_ptr<const RadioConfig> config) {
+    std::atomic_store(&mConfig, std::move(config));
 }
 
 Return<void> BroadcastRadio::getAmFmRegionConfig(bool full, getAmFmRegionConfig_cb _hidl_cb) {
     ALOGV("%s(%d)", __func__, full);
 
-    if (full) {
-        AmFmRegionConfig config = {};
-        config.ranges = hidl_vec<AmFmBandRange>({
-            {65000, 108000, 10, 0},  // FM
-            {150, 30000, 1, 0},      // AM
-        });
-        config.fmDeemphasis = Deemphasis::D50 | Deemphasis::D75;
-        config.fmRds = Rds::RDS | Rds::RBDS;
-        _hidl_cb(Result::OK, config);
-        return {};
-    } else {
-        _hidl_cb(Result::OK, getAmFmConfig());
-        return {};
-    }
+    auto current = config();
+    _hidl_cb(Result::OK, full ? current->amFmFull : current->amFm);
+    return {};
 }
 
 Return<void> BroadcastRadio::getDabRegionConfig(getDabRegionConfig_cb _hidl_cb) {
@@ -119,6 +137,15 @@ Return<void> BroadcastRadio::openSession(const sp<ITunerCallback>& callback,
     ALOGV("%s", __func__);
 
     lock_guard<mutex> lk(mMut);
+    auto start = std::chrono::steady_clock::now();
+    // a session can't open the device while prewarm() is at it
+    if (mWarmThread.joinable()) mWarmThread.join();
+    bool warm;
+    {
+        lock_guard<mutex> warmLk(mWarmMut);
+        warm = mIsWarm;
+        mIsWarm = false;
+    }
 
     auto oldSession = mSession.promote();
     if (oldSession != nullptr) {
@@ -132,18 +159,35 @@ Return<void> BroadcastRadio::openSession(const sp<ITunerCallback>& callback,
     sp<TunerSession> newSession = new TunerSession(*this, callback);
 
     mSession = newSession;
-    ALOGD("opensession done,mSession set done....");
+    ALOGI("openSession done in %lldms (%s)",
+          static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count()),
+          warm ? "warm" : "cold");
 
     _hidl_cb(Result::OK, newSession);
 
     return {};
 }
 
+/*
+ * Images are replied straight from their storage, the reply doesn't own nor copy them.
+ */
 Return<void> BroadcastRadio::getImage(uint32_t id, getImage_cb _hidl_cb) {
     ALOGV("%s(%x)", __func__, id);
+    hidl_vec<uint8_t> image;
 
     if (id == resources::demoPngId) {
-        _hidl_cb(std::vector<uint8_t>(resources::demoPng, std::end(resources::demoPng)));
+        image.setToExternal(const_cast<uint8_t*>(resources::demoPng), sizeof(resources::demoPng));
+        _hidl_cb(image);
+        return {};
+    }
+
+    // held until the reply is sent, eviction can't unmap it meanwhile
+    auto logo = mImages.get(id);
+    if (logo != nullptr) {
+        image.setToExternal(const_cast<uint8_t*>(logo->data()), logo->size());
+        _hidl_cb(image);
         return {};
     }
 
@@ -153,11 +197,29 @@ Return<void> BroadcastRadio::getImage(uint32_t id, getImage_cb _hidl_cb) {
 }
 
 Return<void> BroadcastRadio::registerAnnouncementListener(
-    const hidl_vec<AnnouncementType>& enabled, const sp<IAnnouncementListener>& /* listener */,
+    const hidl_vec<AnnouncementType>& enabled, const sp<IAnnouncementListener>& listener,
     registerAnnouncementListener_cb _hidl_cb) {
     ALOGV("%s(%s)", __func__, toString(enabled).c_str());
 
-    _hidl_cb(Result::NOT_SUPPORTED, nullptr);
+    if (listener == nullptr) {
+        _hidl_cb(Result::INVALID_ARGUMENTS, nullptr);
+        return {};
+    }
+    auto handle = mAnnouncements.registerListener(enabled, listener);
+    _hidl_cb(handle != nullptr ? Result::OK : Result::NOT_SUPPORTED, handle);
+    return {};
+}
+
+Return<void> BroadcastRadio::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGW("%s, no fd to dump into", __func__);
+        return {};
+    }
+    if (options.size() > 0 && options[0] == "--json") {
+        FMR_trace_dump_json(fd->data[0]);
+    } else {
+        FMR_trace_dump(fd->data[0]);
+    }
     return {};
 }
 
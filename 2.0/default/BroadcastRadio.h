@@ -16,6 +16,12 @@
 #ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_BROADCASTRADIO_H
 #define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_BROADCASTRADIO_H
 
+#include "AnnouncementEngine.h"
+#include "ConfigWatcher.h"
+#include "ImageStore.h"
+#include "ParkedThread.h"
+#include "RadioConfig.h"
+#include "TunerJournal.h"
 #include "TunerSession.h"
 
 #include <android/hardware/broadcastradio/2.0/IBroadcastRadio.h>
@@ -28,6 +34,7 @@ namespace broadcastradio {
 namespace V2_0 {
 namespace implementation {
 
+using ::android::hardware::hidl_handle;
 using android::wp;
 
 struct BroadcastRadio : public IBroadcastRadio {
@@ -42,17 +49,42 @@ struct BroadcastRadio : public IBroadcastRadio {
     Return<void> registerAnnouncementListener(const hidl_vec<AnnouncementType>& enabled,
                                               const sp<IAnnouncementListener>& listener,
                                               registerAnnouncementListener_cb _hidl_cb);
+    // IBase: lshal debug dumps the trace of the hal, as chrome trace json with --json
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
 
     std::reference_wrapper<const VirtualRadio> mVirtualRadio;
-    Properties mProperties;
+    TunerJournal mJournal;
+    AnnouncementEngine mAnnouncements;
+    ImageStore mImages;
 
-    AmFmRegionConfig getAmFmConfig() const;
+    /** Current configuration, without locks nor copies. */
+    std::shared_ptr<const RadioConfig> config() const;
+    /** Replaces the configuration, readers holding the previous one keep it. */
+    void publishConfig(std::shared_ptr<const RadioConfig> config);
+
+    /**
+     * Warm start: opens the device and probes it in the background, so the
+     * first openSession() only has to tune. Nothing audible happens here.
+     */
+    void prewarm();
+    /** Whether the chip has rds, probed once then cached. Device must be open. */
+    bool isRdsSupported();
+    /** The thread parked by prewarm(), or a new one. */
+    std::unique_ptr<ParkedThread> takeParkedThread();
 
    private:
     mutable std::mutex mMut;
-    AmFmRegionConfig mAmFmConfig;
+    std::shared_ptr<const RadioConfig> mConfig;  // std::atomic_load/atomic_store only
     wp<TunerSession> mSession;
 
+    std::mutex mWarmMut;
+    std::thread mWarmThread;
+    bool mIsWarm = false;  // device opened by prewarm(), not used by a session yet
+    int mRdsSupport = -1;  // -1 until probed
+    std::unique_ptr<ParkedThread> mParkedThread;
+
+    ConfigWatcher mConfigWatcher;  // fm.conf override, reloads seek/scan thresholds
+
 };
 
 }  // namespace implementation
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.confwatch"
+
+#include "ConfigWatcher.h"
+
+#include <log/log.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+static constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE;
+
+ConfigWatcher::ConfigWatcher(const std::string& path, std::function<void()> onChange)
+    : mDir(path.substr(0, path.rfind('/'))),
+      mName(path.substr(path.rfind('/') + 1)),
+      mOnChange(std::move(onChange)) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+    mInotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    mStopFd = eventfd(0, EFD_CLOEXEC);
+    if (mInotifyFd < 0 || mStopFd < 0 ||
+        inotify_add_watch(mInotifyFd, mDir.c_str(), kWatchMask) < 0) {
+        ALOGW("can't watch %s: %s", mDir.c_str(), strerror(errno));
+        stop();
+        return false;
+    }
+    mThread = std::thread(&ConfigWatcher::threadLoop, this);
+    ALOGI("watching %s/%s", mDir.c_str(), mName.c_str());
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    if (mThread.joinable()) {
+        uint64_t one = 1;
+        if (write(mStopFd, &one, sizeof(one)) != sizeof(one)) {
+            ALOGE("can't stop the watcher: %s", strerror(errno));
+        }
+        mThread.join();
+    }
+    if (mInotifyFd >= 0) close(mInotifyFd);
+    if (mStopFd >= 0) close(mStopFd);
+    mInotifyFd = -1;
+    mStopFd = -1;
+}
+
+void ConfigWatcher::threadLoop() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = {{mInotifyFd, POLLIN, 0}, {mStopFd, POLLIN, 0}};
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            ALOGE("poll failed: %s", strerror(errno));
+            return;
+        }
+        if (fds[1].revents != 0) return;
+
+        // one change of the file may come as several events, it's handled once
+        bool changed = false;
+        ssize_t len;
+        while ((len = read(mInotifyFd, buf, sizeof(buf))) > 0) {
+            for (char* p = buf; p < buf + len;) {
+                auto event = reinterpret_cast<struct inotify_event*>(p);
+                if (event->len > 0 && mName == event->name) changed = true;
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            ALOGI("%s/%s changed", mDir.c_str(), mName.c_str());
+            mOnChange();
+        }
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
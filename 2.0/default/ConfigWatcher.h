@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_CONFIGWATCHER_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_CONFIGWATCHER_H
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/**
+ * Calls onChange on its own thread each time a file is written, replaced or removed.
+ *
+ * Watches the directory of the file with inotify, so the file doesn't need to exist
+ * yet, and editors replacing it by rename are seen too.
+ */
+class ConfigWatcher {
+   public:
+    ConfigWatcher(const std::string& path, std::function<void()> onChange);
+    ~ConfigWatcher();
+
+    /** @Result: false - the directory can't be watched. */
+    bool start();
+    void stop();
+
+   private:
+    const std::string mDir;
+    const std::string mName;
+    const std::function<void()> mOnChange;
+    int mInotifyFd = -1;
+    int mStopFd = -1;  // eventfd waking the thread up for stop()
+    std::thread mThread;
+
+    void threadLoop();
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_CONFIGWATCHER_H
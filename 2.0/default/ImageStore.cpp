@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.images"
+
+#include "ImageStore.h"
+
+#include <log/log.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+
+static constexpr char kLogoSuffix[] = ".png";
+
+ImageStore::Mapping::~Mapping() {
+    munmap(const_cast<void*>(mData), mSize);
+}
+
+ImageStore::ImageStore(const std::string& dir, size_t maxMapped)
+    : mDir(dir), mMaxMapped(maxMapped), mPiIds(std::make_shared<const PiIds>()) {}
+
+uint32_t ImageStore::idForPi(uint16_t pi) {
+    std::call_once(mIndexed, &ImageStore::index, this);
+    auto piIds = std::atomic_load(&mPiIds);
+    auto it = piIds->find(pi);
+    return it != piIds->end() ? it->second : 0;
+}
+
+shared_ptr<const ImageStore::Mapping> ImageStore::get(uint32_t id) {
+    std::call_once(mIndexed, &ImageStore::index, this);
+    lock_guard<mutex> lk(mMut);
+    auto it = mImages.find(id);
+    if (it == mImages.end()) return nullptr;
+
+    Entry& entry = it->second;
+    if (entry.mapping != nullptr) {
+        mLru.splice(mLru.begin(), mLru, entry.lru);
+        return entry.mapping;
+    }
+
+    auto mapping = map(entry.path);
+    if (mapping == nullptr) return nullptr;
+    // the id promises this content, a file replaced since indexing doesn't get served
+    if (imageId(mapping->data(), mapping->size()) != id) {
+        ALOGW("%s changed since indexed", entry.path.c_str());
+        return nullptr;
+    }
+    cacheLocked(id, entry, mapping);
+    return mapping;
+}
+
+void ImageStore::index() {
+    DIR* dir = opendir(mDir.c_str());
+    if (dir == nullptr) {
+        ALOGI("no logos in %s: %s", mDir.c_str(), strerror(errno));
+        return;
+    }
+
+    auto piIds = std::make_shared<PiIds>();
+    lock_guard<mutex> lk(mMut);
+    while (struct dirent* ent = readdir(dir)) {
+        // "<pi in hex>.png"
+        char* end = nullptr;
+        unsigned long pi = strtoul(ent->d_name, &end, 16);
+        if (end == ent->d_name || pi == 0 || pi > UINT16_MAX || strcmp(end, kLogoSuffix) != 0) {
+            continue;
+        }
+
+        std::string path = mDir + "/" + ent->d_name;
+        auto mapping = map(path);
+        if (mapping == nullptr) continue;
+        uint32_t id = imageId(mapping->data(), mapping->size());
+        (*piIds)[pi] = id;
+
+        auto inserted = mImages.emplace(id, Entry{path, nullptr, mLru.end()});
+        if (inserted.second) cacheLocked(id, inserted.first->second, mapping);
+    }
+    closedir(dir);
+    ALOGI("%zu logos of %zu stations in %s, %zu bytes mapped", mImages.size(), piIds->size(),
+          mDir.c_str(), mMapped);
+    std::atomic_store(&mPiIds, std::shared_ptr<const PiIds>(std::move(piIds)));
+}
+
+void ImageStore::cacheLocked(uint32_t id, Entry& entry, shared_ptr<const Mapping> mapping) {
+    // evicted mappings go away once the replies still holding them are sent
+    while (!mLru.empty() && mMapped + mapping->size() > mMaxMapped) {
+        Entry& victim = mImages.at(mLru.back());
+        mMapped -= victim.mapping->size();
+        victim.mapping = nullptr;
+        victim.lru = mLru.end();
+        mLru.pop_back();
+    }
+    if (mMapped + mapping->size() > mMaxMapped) return;  // bigger than the whole budget
+
+    mMapped += mapping->size();
+    mLru.push_front(id);
+    entry.mapping = std::move(mapping);
+    entry.lru = mLru.begin();
+}
+
+shared_ptr<const ImageStore::Mapping> ImageStore::map(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("can't open %s: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // the mapping keeps the file
+    if (data == MAP_FAILED) {
+        ALOGE("can't map %s: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+    return std::make_shared<const Mapping>(data, st.st_size);
+}
+
+uint32_t imageId(const uint8_t* data, size_t size) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_IMAGESTORE_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_IMAGESTORE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/**
+ * Station logos of a vendor directory, served without copies.
+ *
+ * Logos are named after the rds PI they belong to, Eg. "c201.png". The image id is
+ * a hash of the content, so stations sharing a logo share one id and one mapping.
+ * Files are mmap'd read-only and handed out as shared mappings, which stay valid
+ * as long as a reply holds them. At most maxMapped bytes stay mapped, the least
+ * recently used images are unmapped first and mapped again on demand.
+ *
+ * The directory is indexed on first use. Thread safe: the PI index is an immutable
+ * snapshot read without locks, so the rds thread never waits behind a mapping.
+ */
+class ImageStore {
+   public:
+    class Mapping {
+       public:
+        Mapping(const void* data, size_t size) : mData(data), mSize(size) {}
+        ~Mapping();
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        const uint8_t* data() const { return static_cast<const uint8_t*>(mData); }
+        size_t size() const { return mSize; }
+
+       private:
+        const void* mData;
+        size_t mSize;
+    };
+
+    ImageStore(const std::string& dir, size_t maxMapped);
+
+    /** Id of the logo of a station, 0 when there is none. */
+    uint32_t idForPi(uint16_t pi);
+
+    /** The image, nullptr for an unknown id or an unreadable file. */
+    std::shared_ptr<const Mapping> get(uint32_t id);
+
+   private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const Mapping> mapping;  // null while unmapped
+        std::list<uint32_t>::iterator lru;
+    };
+
+    const std::string mDir;
+    const size_t mMaxMapped;
+
+    using PiIds = std::map<uint16_t, uint32_t>;
+
+    std::once_flag mIndexed;
+    std::shared_ptr<const PiIds> mPiIds;  // atomic_load/atomic_store only
+    std::mutex mMut;  // images, lru and budget
+    std::map<uint32_t, Entry> mImages;
+    std::list<uint32_t> mLru;  // mapped images, most recently used first
+    size_t mMapped = 0;
+
+    void index();
+    void cacheLocked(uint32_t id, Entry& entry, std::shared_ptr<const Mapping> mapping);
+    static std::shared_ptr<const Mapping> map(const std::string& path);
+};
+
+/** Content hash used as image id, never 0 (0 means no image). */
+uint32_t imageId(const uint8_t* data, size_t size);
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_IMAGESTORE_H
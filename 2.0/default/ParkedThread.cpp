@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ParkedThread.h"
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+ParkedThread::ParkedThread() : mThread(&ParkedThread::threadLoop, this) {}
+
+ParkedThread::~ParkedThread() {
+    {
+        std::lock_guard<std::mutex> lk(mMut);
+        mReleased = true;
+        mCond.notify_one();
+    }
+    if (mThread.joinable()) mThread.join();
+}
+
+void ParkedThread::start(std::function<void()> task) {
+    std::lock_guard<std::mutex> lk(mMut);
+    if (mStarted) return;
+    mTask = std::move(task);
+    mStarted = true;
+    mCond.notify_one();
+}
+
+void ParkedThread::join() {
+    {
+        std::lock_guard<std::mutex> lk(mMut);
+        if (!mStarted) return;
+    }
+    if (mThread.joinable()) mThread.join();
+}
+
+void ParkedThread::threadLoop() {
+    std::function<void()> task;
+    {
+        std::unique_lock<std::mutex> lk(mMut);
+        mCond.wait(lk, [this] { return mStarted || mReleased; });
+        if (!mStarted) return;
+        task = std::move(mTask);
+    }
+    task();
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
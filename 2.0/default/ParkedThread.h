@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PARKEDTHREAD_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PARKEDTHREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/**
+ * A thread spawned ahead of time, parked until it is given its one task.
+ *
+ * Lets the warm start pay thread creation before the first session needs it.
+ * Dropping a thread that never got a task releases it.
+ */
+class ParkedThread {
+   public:
+    ParkedThread();
+    ~ParkedThread();
+
+    /** Runs task on the parked thread, can only be called once. */
+    void start(std::function<void()> task);
+
+    /** Waits for the task to return, no-op when not started. */
+    void join();
+
+   private:
+    std::mutex mMut;
+    std::condition_variable mCond;
+    std::function<void()> mTask;
+    bool mStarted = false;
+    bool mReleased = false;
+    std::thread mThread;
+
+    void threadLoop();
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PARKEDTHREAD_H
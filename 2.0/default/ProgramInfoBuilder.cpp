@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.infobuilder"
+
+#include "ProgramInfoBuilder.h"
+
+#include <broadcastradio-utils-2x/Utils.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace android::hardware::broadcastradio;
+
+// metadata entries, each added when the station first sends it, so never sent empty
+static constexpr size_t kSlotPs = 0;
+static constexpr size_t kSlotRt = 1;
+static constexpr size_t kSlotPty = 2;
+static constexpr size_t kSlotIcon = 3;
+static constexpr MetadataKey kSlotKeys[] = {
+    MetadataKey::RDS_PS, MetadataKey::RDS_RT, MetadataKey::RDS_PTY, MetadataKey::STATION_ICON,
+};
+
+static constexpr size_t kRtMaxLen = sizeof(RT_Info::TextData[0]);
+
+// rssi range mapped linearly onto signal quality 0-100
+static constexpr int kRssiNoSignal = -110;
+static constexpr int kRssiFullSignal = -60;
+static constexpr uint32_t kSignalQualityHysteresis = 5;
+
+const ProgramInfo& ProgramInfoBuilder::reset(const ProgramSelector& selector) {
+    mTunedSelector = selector;
+    mInfo.selector = selector;
+    mInfo.logicallyTunedTo = utils::make_identifier(
+        IdentifierType::AMFM_FREQUENCY, utils::getId(selector, IdentifierType::AMFM_FREQUENCY));
+    mInfo.physicallyTunedTo = mInfo.logicallyTunedTo;
+    mInfo.infoFlags = 0;
+    mInfo.infoFlags |= ProgramInfoFlags::TUNED;
+    mInfo.signalQuality = 0;
+    if (mInfo.metadata.size() != 0) {
+        mInfo.metadata = hidl_vec<Metadata>();
+    }
+    std::fill(std::begin(mSlots), std::end(mSlots), -1);
+    return mInfo;
+}
+
+const ProgramInfo& ProgramInfoBuilder::update(const RDSData_Struct& rds, uint16_t events,
+                                              uint32_t signalQuality) {
+    mInfo.signalQuality = signalQuality;
+
+    if (events & RDS_EVENT_PROGRAMNAME) {
+        setString(kSlotPs, rds.PS_Data.PS[3], FM_RDS_PS_LEN);
+    }
+    if (events & RDS_EVENT_LAST_RADIOTEXT) {
+        setString(kSlotRt, rds.RT_Data.TextData[3],
+                  std::min<size_t>(rds.RT_Data.TextLength, kRtMaxLen));
+    }
+    if (events & RDS_EVENT_PTY_CODE) {
+        slot(kSlotPty).intValue = rds.PTY;
+    }
+    if (events & RDS_EVENT_PI_CODE) {
+        setPi(rds.PI);
+    }
+    if (events & RDS_EVENT_FLAGS) {
+        mInfo.infoFlags = 0;
+        mInfo.infoFlags |= ProgramInfoFlags::TUNED;
+        if (rds.RDSFlag.Stereo) mInfo.infoFlags |= ProgramInfoFlags::STEREO;
+        if (rds.RDSFlag.TP) mInfo.infoFlags |= ProgramInfoFlags::TRAFFIC_PROGRAM;
+        if (rds.RDSFlag.TA) mInfo.infoFlags |= ProgramInfoFlags::TRAFFIC_ANNOUNCEMENT;
+    }
+
+    return mInfo;
+}
+
+const ProgramInfo& ProgramInfoBuilder::restore(uint16_t pi, const std::string& ps) {
+    if (pi != 0) setPi(pi);
+    if (!ps.empty()) setString(kSlotPs, reinterpret_cast<const uint8_t*>(ps.data()), ps.size());
+    return mInfo;
+}
+
+const ProgramInfo& ProgramInfoBuilder::setIcon(uint32_t id) {
+    if (id == 0) {
+        dropSlot(kSlotIcon);
+        return mInfo;
+    }
+    slot(kSlotIcon).intValue = id;
+    return mInfo;
+}
+
+Metadata& ProgramInfoBuilder::slot(size_t kind) {
+    if (mSlots[kind] < 0) {
+        // first time the station sends it, the only time metadata grows
+        size_t pos = mInfo.metadata.size();
+        mInfo.metadata.resize(pos + 1);
+        mInfo.metadata[pos].key = static_cast<uint32_t>(kSlotKeys[kind]);
+        mSlots[kind] = pos;
+    }
+    return mInfo.metadata[mSlots[kind]];
+}
+
+void ProgramInfoBuilder::dropSlot(size_t kind) {
+    int pos = mSlots[kind];
+    if (pos < 0) return;
+
+    // entries after it move up one
+    size_t size = mInfo.metadata.size();
+    for (size_t i = pos; i + 1 < size; i++) {
+        mInfo.metadata[i] = std::move(mInfo.metadata[i + 1]);
+    }
+    mInfo.metadata.resize(size - 1);
+    for (auto& other : mSlots) {
+        if (other > pos) other--;
+    }
+    mSlots[kind] = -1;
+}
+
+void ProgramInfoBuilder::setPi(uint16_t pi) {
+    auto& ids = mInfo.selector.secondaryIds;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (ids[i].type == static_cast<uint32_t>(IdentifierType::RDS_PI)) {
+            ids[i].value = pi;
+            return;
+        }
+    }
+    // first PI of this station, the only time secondaryIds grows
+    ids.resize(ids.size() + 1);
+    ids[ids.size() - 1] = utils::make_identifier(IdentifierType::RDS_PI, pi);
+}
+
+void ProgramInfoBuilder::setString(size_t kind, const uint8_t* text, size_t len) {
+    char buf[kRtMaxLen];
+    size_t begin = 0;
+    size_t end = std::min(len, sizeof(buf));
+
+    // same rule as COM_change_string: anything out of [0x20,0x7E] shows as space
+    for (size_t i = 0; i < end; i++) {
+        buf[i] = (text[i] >= 0x20 && text[i] <= 0x7E) ? text[i] : ' ';
+    }
+    while (begin < end && buf[begin] == ' ') begin++;
+    while (end > begin && buf[end - 1] == ' ') end--;
+
+    auto& value = slot(kind).stringValue;
+    if (value.size() == end - begin && memcmp(value.c_str(), buf + begin, end - begin) == 0) {
+        return;
+    }
+    value.setTo(buf + begin, end - begin);
+}
+
+uint32_t rssiToSignalQuality(int rssi) {
+    if (rssi <= kRssiNoSignal) return 0;
+    if (rssi >= kRssiFullSignal) return 100;
+    return (rssi - kRssiNoSignal) * 100 / (kRssiFullSignal - kRssiNoSignal);
+}
+
+bool isRdsUpdateNeeded(const ProgramInfo& next, const ProgramInfo& current) {
+    if (next.selector != current.selector) return true;
+    if (next.infoFlags != current.infoFlags) return true;
+    if (next.metadata != current.metadata) return true;
+
+    auto qualityDelta = std::abs(static_cast<int>(next.signalQuality) -
+                                 static_cast<int>(current.signalQuality));
+    return qualityDelta >= static_cast<int>(kSignalQualityHysteresis);
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PROGRAMINFOBUILDER_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PROGRAMINFOBUILDER_H
+
+#include "fmr.h"
+
+#include <android/hardware/broadcastradio/2.0/types.h>
+
+#include <string>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace android::hardware::broadcastradio::V2_0;
+
+/**
+ * Builds ProgramInfo of the tuned station from driver rds snapshots.
+ *
+ * The ProgramInfo is owned by the builder and reused between updates. A metadata
+ * entry is added the first time the station sends that field, and strings are only
+ * rewritten when their content changes, so polling a station with steady rds
+ * allocates nothing.
+ */
+class ProgramInfoBuilder {
+   public:
+    /** Starts over for a newly tuned station, dropping rds data of the previous one. */
+    const ProgramInfo& reset(const ProgramSelector& selector);
+
+    /**
+     * Merges one rds snapshot into the current info.
+     *
+     * Only the fields flagged in events are taken from the snapshot, everything
+     * else keeps the last value received for this station.
+     */
+    const ProgramInfo& update(const RDSData_Struct& rds, uint16_t events, uint32_t signalQuality);
+
+    /**
+     * Takes PI and PS heard on the station earlier, Eg. journaled by the previous session,
+     * kept until rds of the chip replaces them. 0 / empty for none.
+     */
+    const ProgramInfo& restore(uint16_t pi, const std::string& ps);
+
+    /** Sets the STATION_ICON image of the station, 0 for none. */
+    const ProgramInfo& setIcon(uint32_t id);
+
+    const ProgramInfo& get() const { return mInfo; }
+    const ProgramSelector& tunedSelector() const { return mTunedSelector; }
+
+   private:
+    ProgramInfo mInfo = {};
+    ProgramSelector mTunedSelector = {};
+    // where PS, RT, PTY and the icon are in mInfo.metadata, -1 until the station sent it
+    int8_t mSlots[4] = {-1, -1, -1, -1};
+
+    Metadata& slot(size_t kind);
+    void dropSlot(size_t kind);
+    void setPi(uint16_t pi);
+    void setString(size_t kind, const uint8_t* text, size_t len);
+};
+
+/** Maps rssi reported by the chip (dBm) onto ProgramInfo::signalQuality (0-100). */
+uint32_t rssiToSignalQuality(int rssi);
+
+/**
+ * Tells whether next carries anything clients haven't seen in current yet.
+ * Small signal quality jitter alone doesn't trigger an update.
+ */
+bool isRdsUpdateNeeded(const ProgramInfo& next, const ProgramInfo& current);
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_PROGRAMINFOBUILDER_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.config"
+
+#include "RadioConfig.h"
+
+#include <log/log.h>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+// fm.conf bands are in 100kHz, the HAL's in kHz
+static constexpr uint32_t kBandUnit = 100;
+
+static Properties makeProperties(const std::string& product) {
+    Properties prop = {};
+
+    prop.maker = "Google";
+    prop.product = product;
+    prop.supportedIdentifierTypes = hidl_vec<uint32_t>({
+        static_cast<uint32_t>(IdentifierType::AMFM_FREQUENCY),
+        static_cast<uint32_t>(IdentifierType::RDS_PI),
+        static_cast<uint32_t>(IdentifierType::HD_STATION_ID_EXT),
+    });
+    prop.vendorInfo = hidl_vec<VendorKeyValue>({
+        {"com.google.dummy", "dummy"},
+    });
+
+    return prop;
+}
+
+static AmFmBandRange makeFmRange(const CUST_cfg_ds& cfg) {
+    uint32_t low = 875;
+    uint32_t high = 1080;
+    if (cfg.band == FM_BAND_JAPAN) {
+        low = 760;
+        high = 900;
+    } else if (cfg.band == FM_BAND_JAPANW) {
+        low = 760;
+    }
+    // explicit bounds win over the band preset
+    if (cfg.low_band > 0 && cfg.high_band > cfg.low_band) {
+        low = cfg.low_band;
+        high = cfg.high_band;
+    }
+
+    uint32_t spacing = 100;
+    if (cfg.seek_space == 2) spacing = 200;
+    if (cfg.seek_space == 5) spacing = 50;
+
+    return {low * kBandUnit, high * kBandUnit, spacing, spacing};
+}
+
+std::shared_ptr<const RadioConfig> makeRadioConfig(const CUST_cfg_ds& cfg,
+                                                   const std::string& product) {
+    auto config = std::make_shared<RadioConfig>();
+
+    config->properties = makeProperties(product);
+
+    // the chip is FM only
+    config->amFm.ranges = hidl_vec<AmFmBandRange>({makeFmRange(cfg)});
+    config->amFm.fmDeemphasis = static_cast<uint32_t>(Deemphasis::D50);
+    config->amFm.fmRds = static_cast<uint32_t>(Rds::RDS);
+
+    config->amFmFull.ranges = hidl_vec<AmFmBandRange>({
+        {65000, 108000, 10, 0},
+    });
+    config->amFmFull.fmDeemphasis = Deemphasis::D50 | Deemphasis::D75;
+    config->amFmFull.fmRds = Rds::RDS | Rds::RBDS;
+
+    auto& fm = config->amFm.ranges[0];
+    ALOGI("FM %u-%ukHz, spacing %ukHz", fm.lowerBound, fm.upperBound, fm.spacing);
+    return config;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_RADIOCONFIG_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_RADIOCONFIG_H
+
+#include "fmr.h"
+
+#include <android/hardware/broadcastradio/2.0/types.h>
+
+#include <memory>
+#include <string>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace ::android::hardware::broadcastradio::V2_0;
+
+/**
+ * Module configuration derived from fm.conf.
+ *
+ * Never changed once built: a new configuration is a new snapshot, published as a
+ * whole. Readers keep the snapshot they loaded for as long as they need it.
+ */
+struct RadioConfig {
+    Properties properties;
+    AmFmRegionConfig amFm;      // the configured region
+    AmFmRegionConfig amFmFull;  // everything the chip can be configured to
+};
+
+/** Snapshot of cfg (fm.conf values), product is reported in Properties. */
+std::shared_ptr<const RadioConfig> makeRadioConfig(const CUST_cfg_ds& cfg,
+                                                   const std::string& product);
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_RADIOCONFIG_H
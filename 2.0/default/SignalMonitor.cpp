@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SignalMonitor.h"
+
+#include <algorithm>
+#include <climits>
+#include <log/log.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "FM_SIGNAL"
+
+using std::chrono::milliseconds;
+
+static constexpr milliseconds kDefaultPeriod(500);
+static constexpr milliseconds kMinPeriod(50);
+static constexpr milliseconds kMaxPeriod(10000);
+static constexpr int kReadRetries = 4;
+
+SignalMonitor::SignalMonitor(Sampler sampler)
+    : mSampler(std::move(sampler)), mPeriodMs(kDefaultPeriod.count()) {}
+
+SignalMonitor::~SignalMonitor() {
+    stop();
+}
+
+void SignalMonitor::start() {
+    std::lock_guard<std::mutex> lk(mThreadMut);
+    if (mRunning) return;
+    mRunning = true;
+    mThread = std::thread(&SignalMonitor::threadLoop, this);
+    ALOGD("%s, [period=%lld]", __func__, static_cast<long long>(mPeriodMs.load()));
+}
+
+void SignalMonitor::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mThreadMut);
+        if (!mRunning) return;
+        mRunning = false;
+        mCond.notify_all();
+    }
+    mThread.join();
+    invalidate();
+    ALOGD("%s", __func__);
+}
+
+void SignalMonitor::setPeriod(milliseconds period) {
+    period = std::min(std::max(period, kMinPeriod), kMaxPeriod);
+    std::lock_guard<std::mutex> lk(mThreadMut);
+    mPeriodMs = period.count();
+    mCond.notify_all();
+}
+
+milliseconds SignalMonitor::period() const {
+    return milliseconds(mPeriodMs.load(std::memory_order_relaxed));
+}
+
+void SignalMonitor::invalidate() {
+    mValidFrom.store(now(), std::memory_order_release);
+}
+
+void SignalMonitor::pause() {
+    mPaused.fetch_add(1, std::memory_order_acq_rel);
+    invalidate();
+}
+
+void SignalMonitor::resume() {
+    // back on the tuned channel, what was sampled meanwhile belongs to another one
+    invalidate();
+    mPaused.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool SignalMonitor::latest(SignalSample* sample) {
+    if (mPaused.load(std::memory_order_acquire) > 0) return false;
+    if (readFresh(sample)) return true;
+
+    std::lock_guard<std::mutex> lk(mSampleMut);
+    // another reader may have refreshed while we waited
+    if (readFresh(sample)) return true;
+    if (!sampleLocked()) return false;
+    return readFresh(sample);
+}
+
+bool SignalMonitor::newest(SignalSample* sample) const {
+    uint64_t count = mCount.load(std::memory_order_acquire);
+    if (count == 0) return false;
+
+    int64_t time;
+    if (!read(count - 1, &time, sample)) return false;
+    return time >= mValidFrom.load(std::memory_order_acquire);
+}
+
+SignalWindow SignalMonitor::window(milliseconds span) const {
+    SignalWindow w;
+    int64_t from = std::max(now() - static_cast<int64_t>(span.count()) * 1000000,
+                            mValidFrom.load(std::memory_order_acquire));
+    uint64_t count = mCount.load(std::memory_order_acquire);
+    long long sum[3] = {0, 0, 0};
+
+    w.min = {INT_MAX, INT_MAX, INT_MAX};
+    w.max = {INT_MIN, INT_MIN, INT_MIN};
+    for (uint64_t i = count; i > 0 && count - i < kRingSize; i--) {
+        int64_t time;
+        SignalSample s;
+        if (!read(i - 1, &time, &s)) continue; // overwritten meanwhile
+        if (time < from) break;
+        w.min = {std::min(w.min.rssi, s.rssi), std::min(w.min.snr, s.snr),
+                 std::min(w.min.bler, s.bler)};
+        w.max = {std::max(w.max.rssi, s.rssi), std::max(w.max.snr, s.snr),
+                 std::max(w.max.bler, s.bler)};
+        sum[0] += s.rssi;
+        sum[1] += s.snr;
+        sum[2] += s.bler;
+        w.count++;
+    }
+    if (w.count == 0) return SignalWindow();
+    w.mean = {static_cast<int>(sum[0] / w.count), static_cast<int>(sum[1] / w.count),
+              static_cast<int>(sum[2] / w.count)};
+    return w;
+}
+
+void SignalMonitor::threadLoop() {
+    std::unique_lock<std::mutex> lk(mThreadMut);
+    while (mRunning) {
+        lk.unlock();
+        // a reader refreshing right now does this round's work
+        if (mSampleMut.try_lock()) {
+            sampleLocked();
+            mSampleMut.unlock();
+        }
+        lk.lock();
+        mCond.wait_for(lk, period(), [this] { return !mRunning; });
+    }
+}
+
+bool SignalMonitor::sampleLocked() {
+    // stamped before reading, so a sample racing invalidate() is dropped
+    int64_t time = now();
+    SignalSample s;
+    if (mPaused.load(std::memory_order_acquire) > 0) return false;
+    if (!mSampler(&s)) {
+        ALOGE("%s, sampling failed", __func__);
+        return false;
+    }
+    // paused while reading, the chip may already be elsewhere
+    if (mPaused.load(std::memory_order_acquire) > 0) return false;
+
+    uint64_t index = mCount.load(std::memory_order_relaxed);
+    Slot& slot = mRing[index % kRingSize];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time.store(time, std::memory_order_relaxed);
+    slot.rssi.store(s.rssi, std::memory_order_relaxed);
+    slot.snr.store(s.snr, std::memory_order_relaxed);
+    slot.bler.store(s.bler, std::memory_order_relaxed);
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+    mCount.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+bool SignalMonitor::read(uint64_t index, int64_t* time, SignalSample* sample) const {
+    const Slot& slot = mRing[index % kRingSize];
+    for (int i = 0; i < kReadRetries; i++) {
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * (index + 1)) {
+            if (seq > 2 * (index + 1)) return false; // lapped by the writer
+            continue;
+        }
+        *time = slot.time.load(std::memory_order_relaxed);
+        sample->rssi = slot.rssi.load(std::memory_order_relaxed);
+        sample->snr = slot.snr.load(std::memory_order_relaxed);
+        sample->bler = slot.bler.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq) return true;
+    }
+    return false;
+}
+
+bool SignalMonitor::readFresh(SignalSample* sample) const {
+    uint64_t count = mCount.load(std::memory_order_acquire);
+    if (count == 0) return false;
+
+    int64_t time;
+    if (!read(count - 1, &time, sample)) return false;
+    int64_t maxAge = static_cast<int64_t>(period().count()) * 1000000 * 3 / 2;
+    return time >= mValidFrom.load(std::memory_order_acquire) && now() - time <= maxAge;
+}
+
+int64_t SignalMonitor::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __FM_SIGNAL_MONITOR_H__
+#define __FM_SIGNAL_MONITOR_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct SignalSample {
+    int rssi = -1;
+    int snr = -1;
+    int bler = -1;
+};
+
+struct SignalWindow {
+    int count = 0; // samples in the window, min/mean/max are meaningless when 0
+    SignalSample min;
+    SignalSample mean;
+    SignalSample max;
+};
+
+/*
+ * Samples rssi/snr/bler of the tuned channel at a fixed period and keeps the
+ * samples in a ring that all readers share. It runs from power up (or the first tune)
+ * to power down, and is paused while the chip is away from the tuned channel.
+ *
+ * Readers don't lock: each slot is a seqlock, a torn read is retried. A reader only
+ * goes to the chip when the newest sample is older than 1.5 period, and then under
+ * a mutex that dedups concurrent refreshes, so polling readers never multiply ioctls.
+ *
+ * start/stop are called by the owner of the device (open/close, power up/down) and
+ * must not race each other.
+ */
+class SignalMonitor {
+  public:
+    // fills the sample from the chip, false when nothing could be read
+    using Sampler = std::function<bool(SignalSample* sample)>;
+
+    explicit SignalMonitor(Sampler sampler);
+    ~SignalMonitor();
+
+    void start();
+    void stop();
+    void setPeriod(std::chrono::milliseconds period);
+    std::chrono::milliseconds period() const;
+
+    // drops samples taken so far, call once the chip left the channel they belong to
+    void invalidate();
+
+    // around scan, seek and AF checks: no sampling and no valid sample until resume(),
+    // samples of the channel left are dropped. Nests.
+    void pause();
+    void resume();
+
+    // newest valid sample, taken now if the newest one is too old
+    bool latest(SignalSample* sample);
+
+    // newest valid sample whatever its age, never goes to the chip nor blocks
+    bool newest(SignalSample* sample) const;
+
+    // min/mean/max of the valid samples of the last span
+    SignalWindow window(std::chrono::milliseconds span) const;
+
+  private:
+    static constexpr size_t kRingSize = 64;
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0}; // odd while written, 2 * (index + 1) once published
+        std::atomic<int64_t> time{0};
+        std::atomic<int> rssi{-1};
+        std::atomic<int> snr{-1};
+        std::atomic<int> bler{-1};
+    };
+
+    const Sampler mSampler;
+    Slot mRing[kRingSize];
+    std::atomic<uint64_t> mCount{0}; // samples published so far
+    std::atomic<int64_t> mValidFrom{0};
+    std::atomic<int64_t> mPeriodMs;
+    std::atomic<int> mPaused{0};
+
+    std::mutex mSampleMut; // one writer at a time
+    std::mutex mThreadMut;
+    std::condition_variable mCond;
+    std::thread mThread;
+    bool mRunning = false;
+
+    void threadLoop();
+    bool sampleLocked();
+    bool read(uint64_t index, int64_t* time, SignalSample* sample) const;
+    bool readFresh(SignalSample* sample) const;
+    static int64_t now();
+};
+
+#endif
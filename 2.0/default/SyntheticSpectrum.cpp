@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "Vendor.BcRadioDef.Spectrum"
+
+#include "SyntheticSpectrum.h"
+
+#include <broadcastradio-utils-2x/Utils.h>
+#include <log/log.h>
+
+#include <random>
+#include <unordered_set>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using namespace android::hardware::broadcastradio;
+using android::hardware::hidl_vec;
+using std::vector;
+
+static constexpr uint32_t kFmLow = 87500;
+static constexpr uint32_t kFmChannels = (108000 - 87500) / 100 + 1;
+static constexpr uint32_t kAmLow = 153;
+static constexpr uint32_t kAmChannels = 30000 - 153 + 1;
+static constexpr uint32_t kDabLow = 174928;  // 5A
+static constexpr uint32_t kDabBlocks = 38;
+static constexpr uint32_t kDabBlockSpacing = 1712;
+
+namespace {
+
+/*
+ * std distributions are implementation defined, plain modulo keeps the output the
+ * same everywhere; the bias doesn't matter here.
+ */
+class Generator {
+   public:
+    explicit Generator(uint32_t seed) : mRng(seed) {}
+
+    uint64_t below(uint64_t n) { return mRng() % n; }
+
+    // a value below n not drawn before for this set
+    uint64_t unique(std::unordered_set<uint64_t>& used, uint64_t n) {
+        uint64_t v;
+        do {
+            v = below(n);
+        } while (!used.insert(v).second);
+        return v;
+    }
+
+   private:
+    std::mt19937 mRng;
+};
+
+}  // namespace
+
+static VirtualProgram makeProgram(ProgramSelector sel, const char* kind, size_t i) {
+    auto n = std::to_string(i);
+    return {std::move(sel), std::string(kind) + " " + n, "Artist " + n, "Title " + n};
+}
+
+vector<VirtualProgram> generateSpectrum(const SpectrumSpec& spec, uint32_t seed) {
+    Generator gen(seed);
+    std::unordered_set<uint64_t> used;
+    vector<VirtualProgram> programs;
+    programs.reserve(spec.fm + spec.am + spec.hd + spec.dab);
+
+    if (spec.fm > 0xFFFF || spec.am > kAmChannels || spec.dab > 0xFFFF) {
+        ALOGE("spectrum too large: fm %zu am %zu dab %zu", spec.fm, spec.am, spec.dab);
+        return programs;
+    }
+
+    for (size_t i = 0; i < spec.fm; i++) {
+        ProgramSelector sel = {};
+        sel.primaryId = utils::make_identifier(IdentifierType::RDS_PI, gen.unique(used, 0xFFFF) + 1);
+        sel.secondaryIds = hidl_vec<ProgramIdentifier>({utils::make_identifier(
+            IdentifierType::AMFM_FREQUENCY, kFmLow + gen.below(kFmChannels) * 100)});
+        programs.push_back(makeProgram(sel, "FM", i));
+    }
+
+    used.clear();
+    for (size_t i = 0; i < spec.am; i++) {
+        auto freq = kAmLow + gen.unique(used, kAmChannels);
+        programs.push_back(makeProgram(utils::make_selector_amfm(freq), "AM", i));
+    }
+
+    used.clear();
+    for (size_t i = 0; i < spec.hd; i++) {
+        uint64_t freq = kFmLow + gen.below(kFmChannels) * 100;
+        uint64_t station = gen.unique(used, UINT32_MAX);
+        uint64_t subchannel = gen.below(8);
+        ProgramSelector sel = {};
+        sel.primaryId = utils::make_identifier(IdentifierType::HD_STATION_ID_EXT,
+                                               station | (subchannel << 32) | (freq << 36));
+        sel.secondaryIds = hidl_vec<ProgramIdentifier>(
+            {utils::make_identifier(IdentifierType::AMFM_FREQUENCY, freq)});
+        programs.push_back(makeProgram(sel, "HD", i));
+    }
+
+    used.clear();
+    for (size_t i = 0; i < spec.dab; i++) {
+        uint64_t sid = gen.unique(used, 0xFFFF) + 1;
+        uint64_t block = gen.below(kDabBlocks);
+        ProgramSelector sel = {};
+        sel.primaryId = utils::make_identifier(IdentifierType::DAB_SID_EXT, sid);
+        sel.secondaryIds = hidl_vec<ProgramIdentifier>({
+            utils::make_identifier(IdentifierType::DAB_ENSEMBLE, 0x1000 + block),
+            utils::make_identifier(IdentifierType::DAB_FREQUENCY,
+                                   kDabLow + block * kDabBlockSpacing),
+        });
+        programs.push_back(makeProgram(sel, "DAB", i));
+    }
+
+    return programs;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
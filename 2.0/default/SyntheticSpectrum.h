@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_SYNTHETICSPECTRUM_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_SYNTHETICSPECTRUM_H
+
+#include "VirtualProgram.h"
+
+#include <vector>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/** How many programs of each kind to put on the air. */
+struct SpectrumSpec {
+    size_t fm = 0;   // RDS_PI primary, up to 65535
+    size_t am = 0;   // AMFM_FREQUENCY primary, up to 29848
+    size_t hd = 0;   // HD_STATION_ID_EXT primary
+    size_t dab = 0;  // DAB_SID_EXT primary, up to 65535
+};
+
+/**
+ * Generates programs for a VirtualRadio, for load tests.
+ *
+ * The same spec and seed always give the same programs, on any platform: the
+ * generator only relies on std::mt19937, which is fully specified. Identifiers
+ * are unique within each kind, frequencies of FM/HD programs may be shared.
+ */
+std::vector<VirtualProgram> generateSpectrum(const SpectrumSpec& spec, uint32_t seed);
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_SYNTHETICSPECTRUM_H
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.scheduler"
+
+#include "TaskScheduler.h"
+#include "fmr_trace.h"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+static const char* const kClassNames[] = {"control", "tune", "metadata", "list"};
+// trace span names, per class
+static const char* const kQueuedSpans[] = {"queued control", "queued tune", "queued metadata",
+                                           "queued list"};
+static const char* const kRunSpans[] = {"run control", "run tune", "run metadata", "run list"};
+
+// heap order: the earliest due task (first queued on a tie) on top
+static bool runsAfter(const TaskScheduler::Clock::time_point& aDue, uint64_t aSeq,
+                      const TaskScheduler::Clock::time_point& bDue, uint64_t bSeq) {
+    return aDue > bDue || (aDue == bDue && aSeq > bSeq);
+}
+
+TaskScheduler::TaskScheduler() : mThread(&TaskScheduler::threadLoop, this) {}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lk(mMut);
+        mQuit = true;
+        mCond.notify_one();
+    }
+    mThread.join();
+}
+
+void TaskScheduler::schedule(TaskClass cls, std::function<void()> task, milliseconds delay,
+                             milliseconds deadline) {
+    std::lock_guard<std::mutex> lk(mMut);
+    scheduleLocked(cls, std::move(task), delay, deadline);
+}
+
+void TaskScheduler::scheduleLatest(TaskClass cls, std::function<void()> task, milliseconds delay,
+                                   milliseconds deadline) {
+    std::lock_guard<std::mutex> lk(mMut);
+    auto& queue = mQueues[static_cast<size_t>(cls)];
+    mStats[static_cast<size_t>(cls)].dropped += queue.size();
+    queue.clear();
+    scheduleLocked(cls, std::move(task), delay, deadline);
+}
+
+void TaskScheduler::scheduleLocked(TaskClass cls, std::function<void()> task, milliseconds delay,
+                                   milliseconds deadline) {
+    auto due = Clock::now() + delay;
+    auto expires = deadline.count() > 0 ? due + deadline : Clock::time_point::max();
+    auto& queue = mQueues[static_cast<size_t>(cls)];
+
+    queue.push_back({due, expires, mSeq++, FMR_trace_now(), std::move(task)});
+    std::push_heap(queue.begin(), queue.end(), [](const Task& a, const Task& b) {
+        return runsAfter(a.due, a.seq, b.due, b.seq);
+    });
+    mCond.notify_one();
+}
+
+void TaskScheduler::cancel(TaskClass cls) {
+    std::lock_guard<std::mutex> lk(mMut);
+    cancelLocked(cls);
+}
+
+void TaskScheduler::cancelAll() {
+    std::lock_guard<std::mutex> lk(mMut);
+    for (size_t i = 0; i < kClassCount; i++) {
+        cancelLocked(static_cast<TaskClass>(i));
+    }
+}
+
+void TaskScheduler::cancelLocked(TaskClass cls) {
+    auto& queue = mQueues[static_cast<size_t>(cls)];
+    mStats[static_cast<size_t>(cls)].cancelled += queue.size();
+    queue.clear();
+}
+
+TaskScheduler::ClassStats TaskScheduler::stats(TaskClass cls) const {
+    std::lock_guard<std::mutex> lk(mMut);
+    return mStats[static_cast<size_t>(cls)];
+}
+
+std::string TaskScheduler::dumpStats() const {
+    std::lock_guard<std::mutex> lk(mMut);
+    std::ostringstream out;
+    for (size_t i = 0; i < kClassCount; i++) {
+        const ClassStats& s = mStats[i];
+        auto mean = s.run > 0 ? s.totalDelay / static_cast<int64_t>(s.run) : Clock::duration(0);
+        out << kClassNames[i] << ": run " << s.run << ", delay mean "
+            << duration_cast<microseconds>(mean).count() << "us max "
+            << duration_cast<microseconds>(s.maxDelay).count() << "us, dropped " << s.dropped
+            << ", cancelled " << s.cancelled << "\n";
+    }
+    return out.str();
+}
+
+void TaskScheduler::threadLoop() {
+    auto later = [](const Task& a, const Task& b) {
+        return runsAfter(a.due, a.seq, b.due, b.seq);
+    };
+
+    std::unique_lock<std::mutex> lk(mMut);
+    while (!mQuit) {
+        auto now = Clock::now();
+        auto nextDue = Clock::time_point::max();
+        Task task;
+        size_t cls = 0;
+        bool found = false;
+
+        for (size_t i = 0; i < kClassCount && !found; i++) {
+            auto& queue = mQueues[i];
+            while (!queue.empty() && queue.front().due <= now) {
+                std::pop_heap(queue.begin(), queue.end(), later);
+                Task next = std::move(queue.back());
+                queue.pop_back();
+                if (next.expires < now) {
+                    mStats[i].dropped++;
+                    continue;
+                }
+                auto delay = now - next.due;
+                mStats[i].run++;
+                mStats[i].totalDelay += delay;
+                mStats[i].maxDelay = std::max(mStats[i].maxDelay, delay);
+                task = std::move(next);
+                cls = i;
+                found = true;
+                break;
+            }
+            if (!found && !queue.empty()) nextDue = std::min(nextDue, queue.front().due);
+        }
+
+        if (!found) {
+            if (nextDue == Clock::time_point::max()) {
+                mCond.wait(lk);
+            } else {
+                mCond.wait_until(lk, nextDue);
+            }
+            continue;
+        }
+
+        lk.unlock();
+        FMR_SPAN_ASYNC(kQueuedSpans[cls], task.queued, FMR_trace_now(), 0);
+        {
+            FMR_SPAN(kRunSpans[cls]);
+            task.run();
+        }
+        lk.lock();
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
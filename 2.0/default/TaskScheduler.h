@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TASKSCHEDULER_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TASKSCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/** Priority classes of deferred session work, highest first. */
+enum class TaskClass : uint8_t {
+    CONTROL,      // tune/seek/step work
+    TUNE_RESULT,  // callbacks reporting a finished tune
+    METADATA,     // rds updates of the current station
+    LIST,         // program list chunks
+    COUNT,
+};
+
+/**
+ * Runs deferred session work on one thread, by priority class.
+ *
+ * A due task of a higher class always runs before any task of a lower class, tasks
+ * of one class run in due time order. Tasks may carry a deadline, past which they
+ * are dropped instead of run late. Each class can be cancelled on its own, and the
+ * delay between due time and start is accounted per class.
+ */
+class TaskScheduler {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    struct ClassStats {
+        uint64_t run = 0;
+        uint64_t dropped = 0;  // expired or superseded
+        uint64_t cancelled = 0;
+        Clock::duration totalDelay{0};
+        Clock::duration maxDelay{0};
+    };
+
+    TaskScheduler();
+    ~TaskScheduler();
+
+    /**
+     * Queues task to run after delay. With a non zero deadline, the task is dropped
+     * when it couldn't start within deadline of its due time.
+     */
+    void schedule(TaskClass cls, std::function<void()> task,
+                  std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                  std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+    /** Same as schedule, dropping the tasks of cls still pending: only the newest matters. */
+    void scheduleLatest(TaskClass cls, std::function<void()> task,
+                        std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                        std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
+
+    void cancel(TaskClass cls);
+    void cancelAll();
+
+    ClassStats stats(TaskClass cls) const;
+    /** One line per class: runs, mean/max queueing delay, drops. */
+    std::string dumpStats() const;
+
+   private:
+    struct Task {
+        Clock::time_point due;
+        Clock::time_point expires;
+        uint64_t seq;
+        int64_t queued;  // FMR_trace_now() when scheduled, for the trace
+        std::function<void()> run;
+    };
+
+    static constexpr size_t kClassCount = static_cast<size_t>(TaskClass::COUNT);
+
+    mutable std::mutex mMut;
+    std::condition_variable mCond;
+    std::vector<Task> mQueues[kClassCount];  // min-heaps on (due, seq)
+    ClassStats mStats[kClassCount];
+    uint64_t mSeq = 0;
+    bool mQuit = false;
+    std::thread mThread;
+
+    void scheduleLocked(TaskClass cls, std::function<void()> task,
+                        std::chrono::milliseconds delay, std::chrono::milliseconds deadline);
+    void cancelLocked(TaskClass cls);
+    void threadLoop();
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TASKSCHEDULER_H
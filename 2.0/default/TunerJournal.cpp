@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.journal"
+
+#include "TunerJournal.h"
+
+#include <log/log.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+static constexpr uint32_t kMagic = 0x4a4d4646;  // "FFMJ"
+static constexpr uint32_t kVersion = 1;
+static constexpr size_t kRecordCount = 64;
+static constexpr size_t kPsLen = 8;
+
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordCount;
+    uint32_t reserved;
+};
+
+struct JournalRecord {
+    uint32_t seq;  // 0: never written
+    uint32_t freq;
+    uint16_t spacing;
+    uint16_t pi;
+    int8_t antenna;
+    uint8_t rdsEnabled;
+    uint8_t psLen;
+    char ps[kPsLen];
+    uint8_t reserved;
+    uint32_t crc;  // over all the fields above
+};
+
+static constexpr size_t kFileSize =
+    sizeof(JournalHeader) + kRecordCount * sizeof(JournalRecord);
+
+static uint32_t crc32(const void* data, size_t len) {
+    auto p = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+TunerJournal::TunerJournal(const char* path) : mPath(path) {}
+
+TunerJournal::~TunerJournal() {
+    if (mMap != nullptr) munmap(mMap, kFileSize);
+}
+
+bool TunerJournal::restore(State* state) {
+    std::lock_guard<std::mutex> lk(mMut);
+    if (!openLocked()) return false;
+    *state = mState;
+    return mSeq != 0;
+}
+
+void TunerJournal::recordStation(uint32_t freq) {
+    std::lock_guard<std::mutex> lk(mMut);
+    if (!openLocked() || (mSeq != 0 && mState.freq == freq)) return;
+    State state = mState;
+    state.freq = freq;
+    state.pi = 0;
+    state.ps.clear();
+    appendLocked(state);
+}
+
+void TunerJournal::recordRds(uint32_t freq, uint16_t pi, const std::string& ps) {
+    std::lock_guard<std::mutex> lk(mMut);
+    if (!openLocked() || mState.freq != freq) return;
+    std::string trimmed = ps.substr(0, kPsLen);
+    if (mState.pi == pi && mState.ps == trimmed) return;
+    State state = mState;
+    state.pi = pi;
+    state.ps = trimmed;
+    appendLocked(state);
+}
+
+void TunerJournal::recordSettings(int spacing, int antenna, bool rdsEnabled) {
+    std::lock_guard<std::mutex> lk(mMut);
+    if (!openLocked()) return;
+    if (mState.spacing == spacing && mState.antenna == antenna &&
+        mState.rdsEnabled == rdsEnabled) {
+        return;
+    }
+    State state = mState;
+    state.spacing = spacing;
+    state.antenna = antenna;
+    state.rdsEnabled = rdsEnabled;
+    appendLocked(state);
+}
+
+/*
+ * Maps the journal, creating it if needed. /data may not be there at boot,
+ * so a failed open is retried by the next call.
+ */
+bool TunerJournal::openLocked() {
+    if (mMap != nullptr) return true;
+
+    int fd = open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+    if (fd < 0) {
+        if (!mOpenFailed) ALOGW("can't open %s: %s", mPath.c_str(), strerror(errno));
+        mOpenFailed = true;
+        return false;
+    }
+    if (ftruncate(fd, kFileSize) < 0) {
+        ALOGE("can't size %s: %s", mPath.c_str(), strerror(errno));
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, kFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ALOGE("can't map %s: %s", mPath.c_str(), strerror(errno));
+        return false;
+    }
+    mMap = map;
+    mOpenFailed = false;
+
+    auto header = static_cast<JournalHeader*>(mMap);
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->recordCount != kRecordCount) {
+        ALOGI("initializing %s", mPath.c_str());
+        memset(mMap, 0, kFileSize);
+        *header = {kMagic, kVersion, kRecordCount, 0};
+    }
+    if (!loadLocked(&mState)) mSeq = 0;
+    ALOGD("journal opened, seq %u freq %u", mSeq, mState.freq);
+    return true;
+}
+
+bool TunerJournal::loadLocked(State* state) {
+    auto records = reinterpret_cast<const JournalRecord*>(static_cast<JournalHeader*>(mMap) + 1);
+    const JournalRecord* newest = nullptr;
+    for (size_t i = 0; i < kRecordCount; i++) {
+        const JournalRecord& r = records[i];
+        if (r.seq == 0 || r.crc != crc32(&r, offsetof(JournalRecord, crc))) continue;
+        if (newest == nullptr || r.seq > newest->seq) newest = &r;
+    }
+    if (newest == nullptr) return false;
+
+    mSeq = newest->seq;
+    state->freq = newest->freq;
+    state->spacing = newest->spacing;
+    state->antenna = newest->antenna;
+    state->rdsEnabled = newest->rdsEnabled != 0;
+    state->pi = newest->pi;
+    state->ps.assign(newest->ps, std::min<size_t>(newest->psLen, kPsLen));
+    return true;
+}
+
+void TunerJournal::appendLocked(const State& state) {
+    JournalRecord r = {};
+    r.seq = mSeq + 1;
+    r.freq = state.freq;
+    r.spacing = static_cast<uint16_t>(state.spacing);
+    r.pi = state.pi;
+    r.antenna = static_cast<int8_t>(state.antenna);
+    r.rdsEnabled = state.rdsEnabled ? 1 : 0;
+    r.psLen = static_cast<uint8_t>(std::min(state.ps.size(), kPsLen));
+    memcpy(r.ps, state.ps.data(), r.psLen);
+    r.crc = crc32(&r, offsetof(JournalRecord, crc));
+
+    // the slot after the newest one is the oldest, the newest stays intact meanwhile
+    auto records = reinterpret_cast<JournalRecord*>(static_cast<JournalHeader*>(mMap) + 1);
+    records[r.seq % kRecordCount] = r;
+    msync(mMap, kFileSize, MS_ASYNC);
+
+    mSeq = r.seq;
+    mState = state;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TUNERJOURNAL_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TUNERJOURNAL_H
+
+#include <mutex>
+#include <string>
+
+namespace vendor {
+namespace sprd {
+namespace hardware {
+namespace broadcastradio {
+namespace V2_0 {
+namespace implementation {
+
+/**
+ * Remembers tuner state across sessions and service restarts.
+ *
+ * The journal is a small mmap'd file holding a ring of CRC'd records. Every change
+ * appends a full record, restore takes the newest record whose CRC holds, so a
+ * record torn by a crash falls back to the previous one.
+ */
+class TunerJournal {
+   public:
+    struct State {
+        uint32_t freq = 0;  // kHz, 0 when nothing was journaled yet
+        int spacing = 100;  // kHz
+        int antenna = 0;
+        bool rdsEnabled = true;
+        uint16_t pi = 0;    // last good rds of freq, 0 when none
+        std::string ps;
+    };
+
+    explicit TunerJournal(const char* path);
+    ~TunerJournal();
+
+    /** Newest valid state, false when there is none. */
+    bool restore(State* state);
+
+    /** A new station: forgets rds of the previous one. */
+    void recordStation(uint32_t freq);
+    /** Last good PS/PI heard on freq, dropped if the tuner moved on meanwhile. */
+    void recordRds(uint32_t freq, uint16_t pi, const std::string& ps);
+    void recordSettings(int spacing, int antenna, bool rdsEnabled);
+
+   private:
+    const std::string mPath;
+    std::mutex mMut;
+    void* mMap = nullptr;
+    bool mOpenFailed = false;
+    uint32_t mSeq = 0;  // of the newest record
+    State mState;
+
+    bool openLocked();
+    bool loadLocked(State* state);
+    void appendLocked(const State& state);
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace sprd
+}  // namespace vendor
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TUNERJOURNAL_H
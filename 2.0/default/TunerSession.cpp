@@ -15,15 +15,14 @@
  */
 
 #define LOG_TAG "BcRadioDef.tuner"
-#define LOG_NDEBUG 0
 
 #include "TunerSession.h"
 #include "BroadcastRadio.h"
+#include "SignalMonitor.h"
 
 #include <broadcastradio-utils-2x/Utils.h>
 #include <log/log.h>
 #include <pthread.h>
-#include <android-base/strings.h>
 
 namespace vendor {
 namespace sprd {
@@ -54,24 +53,31 @@ static constexpr auto list = 0s;
 
 }  // namespace delay
 
-static int sprdrds_state = 0;
-static int sprdtune_state = 0;
+// an rds update not delivered by then was superseded by the station moving on
+static constexpr auto kMetadataDeadline = 1s;
+
+static bool isOpenState(SessionState state) {
+    return state != SessionState::CLOSED && state != SessionState::CLOSING;
+}
 
 TunerSession::TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback)
-    : mIsTerminating(false), mCallback(callback), mModule(module) {
+    : mCallback(callback), mModule(module) {
+    mState = SessionState::OPENING;
     bool result = openDev();
     ALOGD("TunerSession constructor...openDev :%d",result);
-    if(result){
-        mIsClosed = false;
-        tuneInternalLocked(utils::make_selector_amfm(87500));
+    if(!result){
+        mState = SessionState::CLOSED;
+    }else{
+        // straight to the last station, no 87.5MHz detour
+        TunerJournal::State saved;
+        tuneInternalLocked(utils::make_selector_amfm(restoreJournaledSettings(&saved)), &saved);
 
-        if(1 == isRdsSupport()){
-            mIsRdsSupported = true;
-        }
+        mIsRdsSupported = module.isRdsSupported();
         ALOGW("TunerSession constructor, mIsRdsSupported:%d",mIsRdsSupported);
-        setRdsOnOff(true);
+        setRdsOnOff(mRdsEnabled);
         if(mIsRdsSupported){
-            mRdsUpdateThread = new std::thread(&TunerSession::rdsUpdateThreadLoop,this);
+            mRdsUpdateThread = module.takeParkedThread();
+            mRdsUpdateThread->start([this]() { rdsUpdateThreadLoop(); });
         }
         ALOGW("TunerSession constructor, start rds thread ,powerup done...");
     }
@@ -82,20 +88,103 @@ TunerSession::TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& cal
  */
 TunerSession::~TunerSession(){
     ALOGD("~TunerSession powerdown...");
-    //close();
-    ALOGD("~TunerSession powerdown, before get mutex...");
+    // without close(), the device is left open for the next session, only our thread goes
+    beginClose();
+    joinRdsThread();
+    mState = SessionState::CLOSED;
+    ALOGD("~TunerSession powerdown after join release done...");
+}
+
+bool TunerSession::isOpen() const {
+    return isOpenState(mState.load());
+}
+
+/*
+ * Moves an open session to state `to`.
+ * @Result: false - close has begun, the request must be dropped.
+ */
+bool TunerSession::enterState(SessionState to) {
+    auto current = mState.load();
+    do {
+        if (!isOpenState(current)) return false;
+    } while (!mState.compare_exchange_weak(current, to));
+    return true;
+}
+
+// only the first caller gets true and does the teardown
+bool TunerSession::beginClose() {
+    return enterState(SessionState::CLOSING);
+}
+
+void TunerSession::joinRdsThread() {
     {
+        // the rds thread checks the state under mRdsMut, so it can't miss this wake up
         lock_guard<mutex> lk(mRdsMut);
-        mIsClosed = true;
-        mIsTerminating = true;
         mCondRds.notify_one();
-        ALOGD("~TunerSession powerdown, after set mIsTerminating true...");
     }
-    if(nullptr != mRdsUpdateThread){
-      mRdsUpdateThread->join();
-      ALOGD("~TunerSession powerdown after join release done...");
+    if (mRdsUpdateThread != nullptr) {
+        mRdsUpdateThread->join();
     }
 }
+/*
+ * Re-applies settings of the previous session from the journal.
+ * @Result: frequency to start on, the journaled one when it's still in band.
+ */
+uint64_t TunerSession::restoreJournaledSettings(TunerJournal::State* saved) {
+    uint64_t freq = 87500;
+    if (!mModule.get().mJournal.restore(saved)) return freq;
+
+    ALOGI("restoring freq %u spacing %d antenna %d rds %d", saved->freq, saved->spacing,
+          saved->antenna, saved->rdsEnabled);
+    auto config = module().config();
+    for (auto&& range : config->amFm.ranges) {
+        if (range.lowerBound <= saved->freq && range.upperBound >= saved->freq) {
+            freq = saved->freq;
+            break;
+        }
+    }
+    if (saved->spacing == 50) {
+        mSpacing = 50;
+        setStep(0); //SCAN_STEP_50KHZ 0
+    }
+    if (saved->antenna != 0 && switchAntenna(saved->antenna) == 0) {
+        mAntenna = saved->antenna;
+    }
+    mRdsEnabled = saved->rdsEnabled;
+    if (freq != saved->freq) {
+        saved->pi = 0;
+        saved->ps.clear();
+    }
+    return freq;
+}
+
+/*
+ * Adds PS/PI last heard on the restored station, shown until rds of the chip catches up.
+ * The rds thread goes on from the same info, so its first reads don't drop them. mRdsMut held.
+ */
+void TunerSession::addJournaledRds(const TunerJournal::State& saved, ProgramInfo* info) {
+    mInfoBuilder.reset(info->selector);
+    *info = mInfoBuilder.restore(saved.pi, saved.ps);
+    if (saved.pi != 0) {
+        mKnownPi[saved.freq] = saved.pi;
+    }
+}
+
+void TunerSession::journalSettings() {
+    mModule.get().mJournal.recordSettings(mSpacing, mAntenna, mRdsEnabled);
+}
+
+// PS/PI of info, journaled once they change
+static void journalRds(TunerJournal& journal, uint64_t freq, const ProgramInfo& info) {
+    std::string ps;
+    for (auto&& m : info.metadata) {
+        if (m.key == static_cast<uint32_t>(MetadataKey::RDS_PS)) ps = m.stringValue;
+    }
+    uint16_t pi = utils::getId(info.selector, IdentifierType::RDS_PI, 0);
+    if (pi == 0 && ps.empty()) return;
+    journal.recordRds(freq, pi, ps);
+}
+
 // makes ProgramInfo that points to no program
 static ProgramInfo makeDummyProgramInfo(const ProgramSelector& selector) {
     ProgramInfo info = {};
@@ -103,137 +192,165 @@ static ProgramInfo makeDummyProgramInfo(const ProgramSelector& selector) {
     info.logicallyTunedTo = utils::make_identifier(
         IdentifierType::AMFM_FREQUENCY, utils::getId(selector, IdentifierType::AMFM_FREQUENCY));
     info.physicallyTunedTo = info.logicallyTunedTo;
+    info.infoFlags |= ProgramInfoFlags::TUNED;
     return info;
 }
 /*
-* Add for rds update only,similar with makeDummyProgramInfo
+* Add for rds update only.
 * To make sure,do not update rds immediately when freq changed by seek.tune.scan... etc.
 * Because fm driver need some time to fresh rds,when change to new program,so do not update rds in above function
+* Reads one rds snapshot into mInfoBuilder, which keeps the info of the current station between reads.
 */
-void TunerSession:: makeDummyProgramInfoForRdsUpdate(ProgramInfo* newInfo,const ProgramSelector& selector){
-    newInfo->selector = selector;
-    /*
-     * Add for rds info, RDS events
-     * PS :  RDS_EVENT_PROGRAMNAME = 0x0008;
-     * RT :  RDS_EVENT_LAST_RADIOTEXT = 0x0040;
-     */
-      int rdsEvents = readRds();
-      ALOGD("makeDummyProgramInfoForRdsUpdate,rds events : %d",rdsEvents);
-      // when rds events = 0 ,there will be no rds info in program info ,so app will get null for ps and rt,update callback is unnecessary
-      if(0 != rdsEvents){
-        char* programName = "";
-        char* rtName = "";
-        if(rdsEvents & RDS_EVENT_PROGRAMNAME){
-          programName = getPs();//get ps info
-        }
-        if(rdsEvents & RDS_EVENT_LAST_RADIOTEXT){
-          rtName = getLrText();//get rt info
-        }
-        ALOGD("makeDummyProgramInfoForRdsUpdate,rds events : %d, ps:%s, rt:%s",rdsEvents,programName,rtName);
-
-        newInfo->metadata = hidl_vec<Metadata>({
-          make_metadata(MetadataKey::RDS_PS, programName),
-          make_metadata(MetadataKey::RDS_RT, rtName),
-          //make_metadata(MetadataKey::SONG_TITLE, songTitle),
-          //make_metadata(MetadataKey::SONG_ARTIST, songArtist),
-          //make_metadata(MetadataKey::STATION_ICON, resources::demoPngId),
-          //make_metadata(MetadataKey::ALBUM_ART, resources::demoPngId),
-        });// make metadata
-      }else{
-        newInfo->metadata = hidl_vec<Metadata>({
-          // make metadata null
-        });
-      }
-    newInfo->logicallyTunedTo = utils::make_identifier(
-        IdentifierType::AMFM_FREQUENCY, utils::getId(selector, IdentifierType::AMFM_FREQUENCY));
-    newInfo->physicallyTunedTo = newInfo->logicallyTunedTo;
+const ProgramInfo& TunerSession::readRdsProgramInfo(std::chrono::steady_clock::time_point arrived,
+                                                    uint16_t* events) {
+    if (!(mInfoBuilder.tunedSelector() == mCurrentProgram)) {
+        mInfoBuilder.reset(mCurrentProgram);
+    }
+
+    uint16_t rdsEvents = 0;
+    const RDSData_Struct* rds = readRdsData(&rdsEvents);
+    *events = rdsEvents;
+    ALOGV("readRdsProgramInfo, rds events : 0x%x", rdsEvents);
+    auto freq = utils::getId(mCurrentProgram, IdentifierType::AMFM_FREQUENCY);
+    if (rdsEvents & RDS_EVENT_PI_CODE) {
+        mKnownPi[freq] = rds->PI;
+    }
+    // first, announcements have the tightest latency budget
+    mModule.get().mAnnouncements.update(*rds, rdsEvents, arrived);
+    // an AF switch keeps the AF list, any other tune starts over
+    if (mAfFollower.freq() != freq / 10) {
+        mAfFollower.reset(freq / 10);
+    }
+    mAfFollower.update(*rds, rdsEvents);
+
+    const ProgramInfo& info = mInfoBuilder.update(*rds, rdsEvents, rssiToSignalQuality(getRssi()));
+    if (rdsEvents & RDS_EVENT_PI_CODE) {
+        mInfoBuilder.setIcon(mModule.get().mImages.idForPi(rds->PI));
+    }
+    if (rdsEvents & (RDS_EVENT_PROGRAMNAME | RDS_EVENT_PI_CODE)) {
+        journalRds(mModule.get().mJournal, freq, info);
+    }
+    return info;
 }
 
 /*
- * Add for read rds periodically in a single thread.
- * sleep(xx),how long will be correct?
+ * Add for read rds in a single thread.
+ * The thread sleeps in the driver until rds data is ready, so TA changes are read as
+ * they arrive; signal quality and AF following still run once per kTimeoutDuration.
+ * A driver that can't wait gets the plain kTimeoutDuration polling.
  * start in constructor or not judged by mIsRdsSupported flag
 */
 void TunerSession::rdsUpdateThreadLoop(){
   ALOGD("TunerSession, rdsUpdateThreadLoop  start");
-  // rds supported,when fm powerup and no closed, update rds per x seconds.
-  ProgramInfo newInfo = {};
-  while(!mIsTerminating){
-    std::unique_lock<mutex> lk(mRdsMut);
-    ALOGD("TunerSession come into rdsUpdateThreadLoop ....mIsClosed :%d",mIsClosed);
-    if(!mIsClosed){
-      if(sprdrds_state == 0){
-        makeDummyProgramInfoForRdsUpdate(&newInfo,mCurrentProgram);
+  std::unique_lock<mutex> lk(mRdsMut);
+  std::chrono::steady_clock::time_point lastRound;
+  while(isOpen()){
+      // nothing to read while tuning/seeking/scanning, rds is off then
+      if(!mRdsEnabled || mState != SessionState::IDLE){
+        mCondRds.wait_for(lk,kTimeoutDuration,[&]{return !isOpen();});
+        continue;
       }
-      if(isRdsUpdateNeeded(newInfo)){
-        mCurrentProgramInfo = newInfo; // add for rds callback filter.update current programinfo
-        auto task =[this,newInfo](){
-          lock_guard<mutex> lk(mMut);
-          mCallback->onCurrentProgramInfoChanged(newInfo);
-        };
-        mThread.schedule(task,delay::tune);
-      }
-      // wait for kTimeoutDuration,and break when timeout and mIsClosed = false;
-      // but if timeout and mIsClosed = true, will not wait，run immediately.
-      ALOGD("rdsUpdateThreadLoop, wait_for pred : %d",(true == mIsClosed));
-      mCondRds.wait_for(lk,kTimeoutDuration,[&]{return mIsClosed;});// wait for update rds per 3s.
-      ALOGD("TunerSession  rdsUpdateThreadLoop after wait_for sleep 3s....");
-      lk.unlock();
-   }else{
-      // wait until open or ~TunerSession.
-      ALOGD("rdsUpdateThreadLoop, wait pred : %d",(!mIsClosed || mIsTerminating));
-      // wait when pred is false;  run when (mIsClosed = false or mIsTerminating = true)
-      mCondRds.wait(lk,[&]{return !mIsClosed || mIsTerminating;});// wait for update rds per 3s.
-      ALOGD("TunerSession  rdsUpdateThreadLoop after wait sleep 3s....");
+
+      // a slice at most, close waits for us
       lk.unlock();
-   }
+      int ready = waitRdsEvent(kRdsWaitSlice.count());
+      auto arrived = std::chrono::steady_clock::now();
+      lk.lock();
+      if(!isOpen() || mState != SessionState::IDLE) continue;
+
+      bool periodic = arrived - lastRound >= kTimeoutDuration;
+      if(ready > 0 || periodic){
+        FMR_SPAN("rds round", ready);
+        uint16_t rdsEvents = 0;
+        const ProgramInfo& newInfo = readRdsProgramInfo(arrived, &rdsEvents);
+        if(isRdsUpdateNeeded(newInfo, mCurrentProgramInfo)){
+          mCurrentProgramInfo = newInfo; // add for rds callback filter.update current programinfo
+          auto task =[this,newInfo](){
+            lock_guard<mutex> lk(mMut);
+            FMR_SPAN("onCurrentProgramInfoChanged rds");
+            mCallback->onCurrentProgramInfoChanged(newInfo);
+          };
+          mScheduler.scheduleLatest(TaskClass::METADATA, task, delay::tune, kMetadataDeadline);
+        }
+        if(ready > 0 && rdsEvents == 0 && !periodic){
+          // readable with nothing to read: the driver doesn't implement poll, don't spin
+          mCondRds.wait_for(lk,kRdsWaitSlice,[&]{return !isOpen();});
+        }
+      }
+      if(periodic){
+        FMR_SPAN("af round");
+        followAlternativeFrequency();
+        lastRound = arrived;
+      }
+      if(ready < 0){
+        // wait for kTimeoutDuration, or until close begins.
+        mCondRds.wait_for(lk,kTimeoutDuration,[&]{return !isOpen();});
+      }
   }
-   ALOGD("TunerSession released, rds thread return....");
+   ALOGD("TunerSession closing, rds thread return....");
    // exit rdsthread function due to TunerSession
    return;
 }
 
 /*
-*Add for judgement: whether should update rds info;
-*@Result: true- update; false- do not update;
-*/
-bool TunerSession::isRdsUpdateNeeded(ProgramInfo& info){
-    auto nps =  utils::getMetadataString(info, MetadataKey::RDS_PS);
-    auto nrt =  utils::getMetadataString(info, MetadataKey::RDS_RT);
-    ALOGD("rdsUpdateThreadLoop,newInfo.selector:%s, pss:%s, rt:%s",toString(mCurrentProgram).c_str(),nps->c_str(),nrt->c_str());
-    //ALOGD("rdsUpdateThreadLoop,pss has_value:%d, rt has_value:%d",nps.has_value(),nrt.has_value());
+ * One round of AF following, called from rds thread with mRdsMut held.
+ * mMut is only tried: a client request holding the tuner wins, and the next round retries.
+ */
+void TunerSession::followAlternativeFrequency() {
+    if (!mAfFollower.isEnabled()) return;
+    std::unique_lock<mutex> lk(mMut, std::try_to_lock);
+    if (!lk.owns_lock() || mState != SessionState::IDLE) return;
 
-    auto ops = utils::getMetadataString(mCurrentProgramInfo, MetadataKey::RDS_PS);
-    auto ort = utils::getMetadataString(mCurrentProgramInfo, MetadataKey::RDS_RT);
-    ALOGD("rdsUpdateThreadLoop,mCurrentProgramInfo.selector:%s, ps:%s, rt:%s",toString(mCurrentProgramInfo.selector).c_str(),ops->c_str(),ort->c_str());
-    bool update = true;
-    if((info.selector == mCurrentProgramInfo.selector)&&(android::base::Trim(*nps) == android::base::Trim(*ops))&&(android::base::Trim(*nrt) == android::base::Trim(*ort))){
-       // freq、rds info are the same as last time, do not to update.
-       update = false;
-    }
-    ALOGD("rdsUpdateThreadLoop, isRdsUpdateNeeded: %d", update);
-    return update;
+    auto freq = utils::getId(mCurrentProgram, IdentifierType::AMFM_FREQUENCY);
+    uint16_t af = mAfFollower.poll(freq / 10, getPamd());
+    if (af == 0) return;
+
+    auto start = std::chrono::steady_clock::now();
+    tuneInternalLocked(utils::make_selector_amfm(af * 10), nullptr, true);
+    mAfFollower.onSwitched(af, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - start));
 }
 
-void TunerSession::tuneInternalLocked(const ProgramSelector& sel) {
+/*
+ * Tunes to sel and schedules the tune result.
+ * The session only turns IDLE once the chip is on sel: the rds thread keeps off the chip
+ * until then, so rds of the previous station is never filed under the new one.
+ * @param saved - journal of the previous session, its PS/PI go into the tune result
+ * @param rdsLocked - called from the rds thread, which holds mRdsMut already
+ */
+void TunerSession::tuneInternalLocked(const ProgramSelector& sel,
+                                      const TunerJournal::State* saved, bool rdsLocked) {
     ALOGD("%s(%s)", __func__, toString(sel).c_str());
 
-    VirtualProgram virtualProgram;
     ProgramInfo programInfo;
 
-    mCurrentProgram = sel;
-    auto current = utils::getId(mCurrentProgram, IdentifierType::AMFM_FREQUENCY);
+    auto current = utils::getId(sel, IdentifierType::AMFM_FREQUENCY);
     ALOGD("Tuner::tuneInternalLocked..tune.. current=%lu",current);
-    if (mIsClosed) {
-        sprdtune_state = 1;         //fix native crash
-        return;
+    FMR_SPAN("tuneInternalLocked", current);
+    if (!isOpen()) {
+        return;         //fix native crash
     }
     ::tune(current);
+    mTunedFreq = current;
+    mModule.get().mJournal.recordStation(current);
+    mModule.get().mAnnouncements.reset(current);
     programInfo = makeDummyProgramInfo(sel);
-    mCurrentProgramInfo = programInfo; // add for rds callback filter.
-    mIsTuneCompleted = true;
+    {
+        std::unique_lock<mutex> rdsLk(mRdsMut, std::defer_lock);
+        if (!rdsLocked) rdsLk.lock();
+        mCurrentProgram = sel;
+        if (saved != nullptr) addJournaledRds(*saved, &programInfo);
+        mCurrentProgramInfo = programInfo; // add for rds callback filter.
+        if (!enterState(SessionState::IDLE)) return;
+    }
     setRdsOnOff(true);
-    mCallback->onCurrentProgramInfoChanged(programInfo);
+    // rds of the previous station must not land after this result
+    mScheduler.cancel(TaskClass::METADATA);
+    mScheduler.schedule(TaskClass::TUNE_RESULT, [this, programInfo]() {
+        lock_guard<mutex> lk(mMut);
+        FMR_SPAN("onCurrentProgramInfoChanged tune");
+        mCallback->onCurrentProgramInfoChanged(programInfo);
+    });
 }
 
 const BroadcastRadio& TunerSession::module() const {
@@ -246,10 +363,11 @@ const VirtualRadio& TunerSession::virtualRadio() const {
 
 Return<Result> TunerSession::tune(const ProgramSelector& sel) {
     ALOGD("%s(%s)", __func__, toString(sel).c_str());
+    FMR_SPAN("binder tune");
+    if (!isOpen()) return Result::INVALID_STATE;
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return Result::INVALID_STATE;
 
-    if (!utils::isSupported(module().mProperties, sel)) {
+    if (!utils::isSupported(module().config()->properties, sel)) {
         ALOGW("Selector not supported");
         return Result::NOT_SUPPORTED;
     }
@@ -260,23 +378,25 @@ Return<Result> TunerSession::tune(const ProgramSelector& sel) {
     }
 
     cancelLocked();
+    if (!enterState(SessionState::TUNING)) return Result::INVALID_STATE;
 
     setRdsOnOff(false);
-    mIsTuneCompleted = false;
     auto task = [this, sel]() {
         lock_guard<mutex> lk(mMut);
         tuneInternalLocked(sel);
     };
-    mThread.schedule(task, delay::tune);
+    mScheduler.schedule(TaskClass::CONTROL, task, delay::tune);
 
     return Result::OK;
 }
 
 Return<Result> TunerSession::scan(bool directionUp, bool /* skipSubChannel */) {
     ALOGD("%s", __func__);
+    FMR_SPAN("binder scan", directionUp);
+    if (!isOpen()) return Result::INVALID_STATE;
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return Result::INVALID_STATE;
     cancelLocked();
+    if (!enterState(SessionState::SEEKING)) return Result::INVALID_STATE;
 
  /*Original code here.
   * There maybe two path for this implement:
@@ -292,26 +412,22 @@ Return<Result> TunerSession::scan(bool directionUp, bool /* skipSubChannel */) {
     ALOGD("scan station..,after seek,current=%lu, seekResult=%d",current,(int)seekResult);
     auto tuneTo = utils::make_selector_amfm((int)seekResult);
 
-    mIsTuneCompleted = false;
     auto task = [this, tuneTo, directionUp]() {
         ALOGI("Performing seek up=%d", directionUp);
 
         lock_guard<mutex> lk(mMut);
         tuneInternalLocked(tuneTo);
     };
-    if (sprdtune_state == 1) {
-        ALOGD("sprdtune when close TunerSession");
-        return Result::INVALID_STATE;
-    }
-    mThread.schedule(task, delay::seek);
+    mScheduler.schedule(TaskClass::CONTROL, task, delay::seek);
 
     return Result::OK;
 }
 
 Return<Result> TunerSession::step(bool directionUp) {
     ALOGD("%s", __func__);
+    FMR_SPAN("binder step", directionUp);
+    if (!isOpen()) return Result::INVALID_STATE;
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return Result::INVALID_STATE;
 
     cancelLocked();
 
@@ -336,7 +452,7 @@ Return<Result> TunerSession::step(bool directionUp) {
     if (stepTo > range->upperBound) stepTo = range->lowerBound;
     if (stepTo < range->lowerBound) stepTo = range->upperBound;
 
-    mIsTuneCompleted = false;
+    if (!enterState(SessionState::TUNING)) return Result::INVALID_STATE;
     auto task = [this, stepTo]() {
         ALOGI("Performing step to %s", std::to_string(stepTo).c_str());
 
@@ -344,7 +460,7 @@ Return<Result> TunerSession::step(bool directionUp) {
 
         tuneInternalLocked(utils::make_selector_amfm(stepTo));
     };
-    mThread.schedule(task, delay::step);
+    mScheduler.schedule(TaskClass::CONTROL, task, delay::step);
 
     return Result::OK;
 }
@@ -352,59 +468,121 @@ Return<Result> TunerSession::step(bool directionUp) {
 void TunerSession::cancelLocked() {
     ALOGD("%s", __func__);
 
-    mThread.cancelAll();
+    // results of finished tunes and rds still go out, only the tuner work is dropped
+    mScheduler.cancel(TaskClass::CONTROL);
     if (utils::getType(mCurrentProgram.primaryId) != IdentifierType::INVALID) {
-        mIsTuneCompleted = true;
+        enterState(SessionState::IDLE);
     }
 }
 
 Return<void> TunerSession::cancel() {
     ALOGD("%s", __func__);
+    if (!isOpen()) return {};
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return {};
 
     cancelLocked();
 
     return {};
 }
 
+/*
+ * Translates a program filter into the part of the band worth sweeping.
+ * FM stations only carry AMFM_FREQUENCY and RDS_PI identifiers, so a filter asking for
+ * anything else can't match and the sweep is skipped; listed frequencies bound the sweep,
+ * while a PI can be on air anywhere and keeps the whole band.
+ * @Result: false - nothing on FM can satisfy the filter.
+ */
+static bool getScanBounds(const ProgramFilter& filter, int* lowFreq, int* highFreq) {
+    auto isFmType = [](uint32_t type) {
+        return type == static_cast<uint32_t>(IdentifierType::AMFM_FREQUENCY) ||
+               type == static_cast<uint32_t>(IdentifierType::RDS_PI);
+    };
+
+    *lowFreq = 0;
+    *highFreq = 0;
+    if (filter.identifierTypes.size() > 0 &&
+        std::none_of(filter.identifierTypes.begin(), filter.identifierTypes.end(), isFmType)) {
+        return false;
+    }
+    if (filter.identifiers.size() == 0) return true;
+
+    bool anyFm = false;
+    bool anyPi = false;
+    uint64_t low = UINT64_MAX;
+    uint64_t high = 0;
+    for (auto&& id : filter.identifiers) {
+        if (id.type == static_cast<uint32_t>(IdentifierType::RDS_PI)) {
+            anyPi = true;
+        } else if (id.type == static_cast<uint32_t>(IdentifierType::AMFM_FREQUENCY)) {
+            low = std::min(low, id.value);
+            high = std::max(high, id.value);
+        } else {
+            continue;
+        }
+        anyFm = true;
+    }
+    if (!anyFm) return false;
+    if (!anyPi) {
+        *lowFreq = static_cast<int>(low);
+        *highFreq = static_cast<int>(high);
+    }
+    return true;
+}
+
 Return<Result> TunerSession::startProgramListUpdates(const ProgramFilter& filter) {
     ALOGD("%s(%s)", __func__, toString(filter).c_str());
+    FMR_SPAN("binder startProgramListUpdates");
+    if (!isOpen()) return Result::INVALID_STATE;
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return Result::INVALID_STATE;
-       setRdsOnOff(false);
-       // real autoScan directly
-        ALOGD("start autoScan..");
+    if (!enterState(SessionState::SCANNING)) return Result::INVALID_STATE;
+
+    int lowFreq = 0;
+    int highFreq = 0;
+    std::vector<VirtualProgram> filteredList;
+    if (getScanBounds(filter, &lowFreq, &highFreq)) {
+        setRdsOnOff(false);
+        // real autoScan directly, on the part of the band the filter can match
+        ALOGD("start autoScan.. [%d, %d]", lowFreq, highFreq);
         int* results = nullptr;
         int length = 0;
-        results = autoScan(&length, mSpacing);
+        results = autoScanRange(&length, mSpacing, lowFreq, highFreq);
         ALOGD("autoScan done..results: %p, length:%d",results,length);
-        std::vector<VirtualProgram> mScanedPrograms;
-        for(int i=0;i<length;i++){
-           ALOGD("after autoScan..make program ,results[i] :%d",results[i]);
-           mScanedPrograms.push_back({make_selector_amfm(10*results[i]),"","",""});
+        {
+            lock_guard<mutex> rdsLk(mRdsMut);
+            for(int i=0;i<length;i++){
+                auto sel = make_selector_amfm(10*results[i]);
+                auto pi = mKnownPi.find(10*results[i]);
+                if (pi != mKnownPi.end()) {
+                    sel.secondaryIds = hidl_vec<ProgramIdentifier>({
+                        make_identifier(IdentifierType::RDS_PI, pi->second)});
+                }
+                if (utils::satisfies(filter, sel)) {
+                    filteredList.push_back({sel,"","",""});
+                }
+            }
         }
-        delete results; // need to be deleted after used
+        delete[] results; // need to be deleted after used
         setRdsOnOff(true);
-
-        vector<VirtualProgram> filteredList;
-        auto filterCb = [&filter](const VirtualProgram& program) {
-            return utils::satisfies(filter, program.selector);
-        };
-        std::copy_if(mScanedPrograms.begin(), mScanedPrograms.end(), std::back_inserter(filteredList), filterCb);
-
-        auto task = [this, mScanedPrograms]() {
+    } else {
+        ALOGI("filter can't match any FM station, skip autoScan");
+    }
+    enterState(SessionState::IDLE);
+
+    // the new list purges the old one, chunks of it still queued are moot
+    mScheduler.cancel(TaskClass::LIST);
+    // converted once, chunks point into the shared list
+    auto infos = std::make_shared<const std::vector<ProgramInfo>>(filteredList.begin(),
+                                                                  filteredList.end());
+    for (size_t n = 0, count = listChunkCount(infos->size()); n < count; n++) {
+        auto task = [this, infos, n]() {
             lock_guard<mutex> lk(mMut);
 
-            ProgramListChunk chunk = {};
-            chunk.purge = true;
-            chunk.complete = true;
-            chunk.modified = hidl_vec<ProgramInfo>(mScanedPrograms.begin(), mScanedPrograms.end());
-
-            mCallback->onProgramListUpdated(chunk);
+            ProgramListChunk listChunk = makeListChunk(*infos, n);
+            FMR_SPAN("onProgramListUpdated", listChunk.modified.size());
+            mCallback->onProgramListUpdated(listChunk);
         };
-
-    mThread.schedule(task, delay::list);
+        mScheduler.schedule(TaskClass::LIST, task, delay::list);
+    }
 
     return Result::OK;
 }
@@ -421,6 +599,11 @@ Return<void> TunerSession::stopProgramListUpdates() {
 Return<void> TunerSession::isConfigFlagSet(ConfigFlag flag, isConfigFlagSet_cb _hidl_cb) {
     ALOGD("%s(%s)", __func__, toString(flag).c_str());
 
+    if (flag == ConfigFlag::RDS_AF && mIsRdsSupported) {
+        lock_guard<mutex> lk(mRdsMut);
+        _hidl_cb(Result::OK, mAfFollower.isEnabled());
+        return {};
+    }
     _hidl_cb(Result::NOT_SUPPORTED, false);
     return {};
 }
@@ -428,105 +611,274 @@ Return<void> TunerSession::isConfigFlagSet(ConfigFlag flag, isConfigFlagSet_cb _
 Return<Result> TunerSession::setConfigFlag(ConfigFlag flag, bool value) {
     ALOGD("%s(%s, %d)", __func__, toString(flag).c_str(), value);
 
+    if (flag == ConfigFlag::RDS_AF && mIsRdsSupported) {
+        lock_guard<mutex> lk(mRdsMut);
+        mAfFollower.setEnabled(value);
+        return Result::OK;
+    }
     return Result::NOT_SUPPORTED;
 }
 
+const TunerSession::ParameterSetter TunerSession::kParameterSetters[] = {
+    {"spacing", &TunerSession::setSpacingParameter},
+    {"antenna", &TunerSession::setAntennaParameter},
+    {"stopScan", &TunerSession::stopScanParameter},
+    {"sprdsetrds", &TunerSession::setRdsParameter},
+    {"signalPeriod", &TunerSession::setSignalPeriodParameter},
+    {"signalWindow", &TunerSession::setSignalWindowParameter},
+};
+
+const TunerSession::ParameterGetter TunerSession::kParameterGetters[] = {
+    {"rssi", &TunerSession::getRssiParameter},
+    {"snr", &TunerSession::getSnrParameter},
+    {"bler", &TunerSession::getBlerParameter},
+    {"stereo", &TunerSession::getStereoParameter},
+    {"chipid", &TunerSession::getChipIdParameter},
+    {"freq", &TunerSession::getFreqParameter},
+    {"spacing", &TunerSession::getSpacingParameter},
+    {"antenna", &TunerSession::getAntennaParameter},
+    {"signalPeriod", &TunerSession::getSignalPeriodParameter},
+    {"rssiWindow", &TunerSession::getRssiWindowParameter},
+    {"snrWindow", &TunerSession::getSnrWindowParameter},
+    {"blerWindow", &TunerSession::getBlerWindowParameter},
+    {"taskDelays", &TunerSession::getTaskDelaysParameter},
+    {"announcementLatency", &TunerSession::getAnnouncementLatencyParameter},
+};
+
+/*
+ * Applies every known key, in the order given, and answers one result per applied key.
+ * Unknown keys are skipped.
+ */
 Return<void> TunerSession::setParameters(const hidl_vec<VendorKeyValue>& parameters,
                                          setParameters_cb _hidl_cb) {
     ALOGD("%s parameters length = %d", __func__,parameters.size());
     lock_guard<mutex> lk(mSetParametersMut);
     vector<VendorKeyValue> result;
     for(size_t i = 0; i < parameters.size(); ++i) {
-        if("spacing" == parameters[i].key){
-            ALOGD("set spacing %s",parameters[i].value.c_str());
-            int ret = 0;
-            if ("50k" == parameters[i].value) {
-                mSpacing = 50;
-                ret = setStep(0); //SCAN_STEP_50KHZ 0
-            } else if("100k" == parameters[i].value) {
-                mSpacing = 100;
-                ret = setStep(1); //SCAN_STEP_100KHZ 1
-            }
-            hidl_vec<VendorKeyValue> vec = {{"spacing",std::to_string(ret)}};
-            _hidl_cb(vec);
-            return Void();
-        }else if("antenna" == parameters[i].key){
-            int ret = 0;
-            ALOGD("switch antenna %s",parameters[i].value.c_str());
-            ret = switchAntenna(parameters[i].value == "0" ? 0 : 1);
-            hidl_vec<VendorKeyValue> vec = {{"antenna",std::to_string(ret)}};
-            _hidl_cb(vec);
-            return Void();
-        }else if("stopScan" == parameters[i].key){
-            int ret = 0;
-            ALOGD("stopScan %s",parameters[i].value.c_str());
-            ret = stopScan() ? 1 : 0;
-            hidl_vec<VendorKeyValue> vec = {{"stopScan",std::to_string(ret)}};
-            _hidl_cb(vec);
-            return Void();
-        }else if("sprdsetrds" == parameters[i].key){
-            ALOGD("set sprdsetrds %s",parameters[i].value.c_str());
-            int ret = 0;
-            if ("sprdrdson" == parameters[i].value) {
-                ret = setRds(1); //set rds on
-                sprdrds_state = 0;
-                ALOGD("set sprdrds on");
-            } else if("sprdrdsoff" == parameters[i].value) {
-                ret = setRds(0); //set rds off
-                sprdrds_state = 1;
-                ALOGD("set sprdrds off");
-                }
-            hidl_vec<VendorKeyValue> vec = {{"sprdsetrds",std::to_string(ret)}};
-            _hidl_cb(vec);
-            return Void();
-       }
+        auto setter = std::find_if(std::begin(kParameterSetters), std::end(kParameterSetters),
+                                   [&](const ParameterSetter& s) { return parameters[i].key == s.key; });
+        if (setter == std::end(kParameterSetters)) {
+            ALOGW("%s unknown key %s", __func__, parameters[i].key.c_str());
+            continue;
+        }
+        int ret = (this->*setter->set)(parameters[i].value);
+        result.push_back({parameters[i].key, std::to_string(ret)});
     }
-    _hidl_cb({});
+    _hidl_cb(result);
     return {};
 }
 
+/*
+ * Answers the requested keys, or all of them when none is given. Takes no session lock:
+ * values come from atomics and the signal monitor, so a poll never waits for a scan
+ * or seek to finish. rssi/snr/bler of one reply come from the same sample.
+ */
 Return<void> TunerSession::getParameters(const hidl_vec<hidl_string>&  keys,
                                          getParameters_cb _hidl_cb) {
     ALOGD("%s keys length = %d", __func__,keys.size());
-    for(size_t i = 0; i < keys.size(); ++i) {
-        if(keys[i] == "rssi") {
-            int rssi = getRssi();
-            hidl_vec<VendorKeyValue> vec = {{"rssi",std::to_string(rssi)}};
-            _hidl_cb(vec);
-            return Void();
+    vector<VendorKeyValue> result;
+    ParameterReply reply;
+    if (keys.size() == 0) {
+        for (auto&& getter : kParameterGetters) {
+            result.push_back({getter.key, (this->*getter.get)(reply)});
         }
     }
-    _hidl_cb({});
+    for(size_t i = 0; i < keys.size(); ++i) {
+        auto getter = std::find_if(std::begin(kParameterGetters), std::end(kParameterGetters),
+                                   [&](const ParameterGetter& g) { return keys[i] == g.key; });
+        if (getter == std::end(kParameterGetters)) continue;
+        result.push_back({keys[i], (this->*getter->get)(reply)});
+    }
+    _hidl_cb(result);
     return {};
 }
 
+int TunerSession::setSpacingParameter(const hidl_string& value) {
+    ALOGD("set spacing %s",value.c_str());
+    int ret = 0;
+    if ("50k" == value) {
+        mSpacing = 50;
+        ret = setStep(0); //SCAN_STEP_50KHZ 0
+    } else if("100k" == value) {
+        mSpacing = 100;
+        ret = setStep(1); //SCAN_STEP_100KHZ 1
+    }
+    journalSettings();
+    return ret;
+}
+
+int TunerSession::setAntennaParameter(const hidl_string& value) {
+    ALOGD("switch antenna %s",value.c_str());
+    int antenna = value == "0" ? 0 : 1;
+    int ret = switchAntenna(antenna);
+    if (ret == 0) {
+        mAntenna = antenna;
+        journalSettings();
+    }
+    return ret;
+}
+
+int TunerSession::stopScanParameter(const hidl_string& value) {
+    ALOGD("stopScan %s",value.c_str());
+    return stopScan() ? 1 : 0;
+}
+
+int TunerSession::setRdsParameter(const hidl_string& value) {
+    ALOGD("set sprdsetrds %s",value.c_str());
+    int ret = 0;
+    if ("sprdrdson" == value) {
+        ret = setRds(1); //set rds on
+        mRdsEnabled = true;
+        ALOGD("set sprdrds on");
+    } else if("sprdrdsoff" == value) {
+        ret = setRds(0); //set rds off
+        mRdsEnabled = false;
+        ALOGD("set sprdrds off");
+    }
+    journalSettings();
+    return ret;
+}
+
+// sampling period of the signal monitor, in ms
+int TunerSession::setSignalPeriodParameter(const hidl_string& value) {
+    ALOGD("set signalPeriod %s",value.c_str());
+    int period = atoi(value.c_str());
+    if (period <= 0) return -1;
+    getSignalMonitor().setPeriod(std::chrono::milliseconds(period));
+    return 0;
+}
+
+// span of rssiWindow/snrWindow/blerWindow, in ms
+int TunerSession::setSignalWindowParameter(const hidl_string& value) {
+    ALOGD("set signalWindow %s",value.c_str());
+    int window = atoi(value.c_str());
+    if (window <= 0) return -1;
+    mSignalWindow = std::chrono::milliseconds(window);
+    return 0;
+}
+
+// the signal sample of the reply, taken on first use; nullptr when there is none
+const SignalSample* TunerSession::replySignal(ParameterReply& reply) {
+    if (!reply.sampled) {
+        reply.hasSignal = getSignalMonitor().latest(&reply.signal);
+        reply.sampled = true;
+    }
+    return reply.hasSignal ? &reply.signal : nullptr;
+}
+
+/*
+ * Runs a chip query the signal monitor doesn't cover, only while tuned and idle: mid
+ * scan or seek the chip sits on another channel, and close may be releasing the device.
+ * Never waits for either, the answer is -1 while the session is busy.
+ */
+int TunerSession::queryIdleChip(int (*query)()) {
+    std::unique_lock<mutex> lk(mMut, std::try_to_lock);
+    if (!lk.owns_lock() || mState != SessionState::IDLE) return -1;
+    return query();
+}
+
+std::string TunerSession::getRssiParameter(ParameterReply& reply) {
+    auto signal = replySignal(reply);
+    return std::to_string(signal != nullptr ? signal->rssi : -1);
+}
+
+std::string TunerSession::getSnrParameter(ParameterReply& reply) {
+    auto signal = replySignal(reply);
+    return std::to_string(signal != nullptr ? signal->snr : -1);
+}
+
+std::string TunerSession::getBlerParameter(ParameterReply& reply) {
+    auto signal = replySignal(reply);
+    return std::to_string(signal != nullptr ? signal->bler : -1);
+}
+
+std::string TunerSession::getStereoParameter(ParameterReply&) {
+    return std::to_string(queryIdleChip(getStereo));
+}
+
+std::string TunerSession::getChipIdParameter(ParameterReply&) {
+    int chipId = mChipId;
+    if (chipId < 0) {
+        chipId = queryIdleChip(getChipId);
+        mChipId = chipId;
+    }
+    return std::to_string(chipId);
+}
+
+std::string TunerSession::getFreqParameter(ParameterReply&) {
+    return std::to_string(mTunedFreq.load());
+}
+
+std::string TunerSession::getSpacingParameter(ParameterReply&) {
+    return std::to_string(mSpacing.load());
+}
+
+std::string TunerSession::getAntennaParameter(ParameterReply&) {
+    return std::to_string(mAntenna.load());
+}
+
+std::string TunerSession::getSignalPeriodParameter(ParameterReply&) {
+    return std::to_string(getSignalMonitor().period().count());
+}
+
+// "min,mean,max" of the samples in the window, empty when there is none
+static std::string formatWindow(const SignalWindow& w, int SignalSample::*field) {
+    if (w.count == 0) return "";
+    return std::to_string(w.min.*field) + "," + std::to_string(w.mean.*field) + "," +
+           std::to_string(w.max.*field);
+}
+
+std::string TunerSession::getRssiWindowParameter(ParameterReply&) {
+    return formatWindow(getSignalMonitor().window(mSignalWindow.load()), &SignalSample::rssi);
+}
+
+std::string TunerSession::getSnrWindowParameter(ParameterReply&) {
+    return formatWindow(getSignalMonitor().window(mSignalWindow.load()), &SignalSample::snr);
+}
+
+std::string TunerSession::getBlerWindowParameter(ParameterReply&) {
+    return formatWindow(getSignalMonitor().window(mSignalWindow.load()), &SignalSample::bler);
+}
+
+// queueing delay and drops of the session work, per priority class
+std::string TunerSession::getTaskDelaysParameter(ParameterReply&) {
+    return mScheduler.dumpStats();
+}
+
+// "notified,late,last ms,max ms" of traffic announcement notifications
+std::string TunerSession::getAnnouncementLatencyParameter(ParameterReply&) {
+    auto stats = mModule.get().mAnnouncements.stats();
+    return std::to_string(stats.notified) + "," + std::to_string(stats.late) + "," +
+           std::to_string(stats.lastLatency.count()) + "," +
+           std::to_string(stats.maxLatency.count());
+}
+
 Return<void> TunerSession::close() {
     ALOGD("%s", __func__);
+    // waits for a tune/scan in flight, new ones are refused from now on
     lock_guard<mutex> lk(mMut);
-    if (mIsClosed) return {};
-    {
-      ALOGD("TunerSession close before set mIsClosed true...");
-      lock_guard<mutex> lk(mRdsMut);
-      mIsClosed = true;
-      setRdsOnOff(false);
-      closeDev();
-      mCondRds.notify_one();
-      ALOGD("TunerSession close after set mIsClosed true...");
-    }
-    mThread.cancelAll();
+    if (!beginClose()) return {};
+    joinRdsThread();
+    setRdsOnOff(false);
+    closeDev();
+    mModule.get().mAnnouncements.reset(0);
+    mScheduler.cancelAll();
+    mState = SessionState::CLOSED;
+    ALOGD("TunerSession close done...");
 
     return {};
 }
 
 std::optional<AmFmBandRange> TunerSession::getAmFmRangeLocked() const {
-    if (!mIsTuneCompleted) {
+    if (mState != SessionState::IDLE) {
         ALOGW("tune operation in process");
         return {};
     }
     if (!utils::hasId(mCurrentProgram, IdentifierType::AMFM_FREQUENCY)) return {};
 
     auto freq = utils::getId(mCurrentProgram, IdentifierType::AMFM_FREQUENCY);
-    for (auto&& range : module().getAmFmConfig().ranges) {
+    auto config = module().config();
+    for (auto&& range : config->amFm.ranges) {
         if (range.lowerBound <= freq && range.upperBound >= freq) return range;
     }
 
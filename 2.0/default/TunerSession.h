@@ -16,15 +16,21 @@
 #ifndef ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TUNER_H
 #define ANDROID_HARDWARE_BROADCASTRADIO_V2_0_TUNER_H
 
+#include "AfFollower.h"
+#include "ParkedThread.h"
+#include "TaskScheduler.h"
+#include "TunerJournal.h"
+#include "ProgramInfoBuilder.h"
+#include "SignalMonitor.h"
 #include "VirtualRadio.h"
 #include "fmr.h"
 
 #include <android/hardware/broadcastradio/2.0/ITunerCallback.h>
 #include <android/hardware/broadcastradio/2.0/ITunerSession.h>
 #include <android/hardware/broadcastradio/2.0/types.h>
-#include <broadcastradio-utils/WorkerThread.h>
 #include <thread>
 
+#include <map>
 #include <optional>
 
 namespace vendor {
@@ -41,10 +47,23 @@ using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 using ::android::sp;
-using ::android::WorkerThread;
 
 struct BroadcastRadio;
 
+/*
+ * Life cycle of a session. Only OPENING..SCANNING accept requests, and a session
+ * never comes back from CLOSING/CLOSED.
+ */
+enum class SessionState : uint8_t {
+    CLOSED,
+    OPENING,
+    IDLE,      // tuned, nothing in flight
+    TUNING,    // tune/step scheduled
+    SEEKING,   // scan (seek) in flight
+    SCANNING,  // program list scan in flight
+    CLOSING,
+};
+
 struct TunerSession : public ITunerSession {
     TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback);
     ~TunerSession();
@@ -69,35 +88,90 @@ struct TunerSession : public ITunerSession {
     std::mutex mMut;
     std::mutex mSetParametersMut;
     std::mutex mRdsMut; // for rds update.
-    WorkerThread mThread;
-    bool mIsClosed = true;
-    bool mIsPowerUp = false; // add for powerup judgement
+    TaskScheduler mScheduler;
+    // checked without locks, changed with CAS; mMut still serializes the work behind it
+    std::atomic<SessionState> mState{SessionState::CLOSED};
     bool mIsRdsSupported = false; // add for rds
-    std::atomic<bool> mIsTerminating;
+    std::atomic<bool> mRdsEnabled{true}; // "sprdsetrds" vendor parameter
     constexpr static auto kTimeoutDuration = std::chrono::milliseconds(500);
-    std::condition_variable mCondRds;
+    constexpr static auto kRdsWaitSlice = std::chrono::milliseconds(100); // longest sleep in the driver
+    std::condition_variable mCondRds; // wakes the rds thread up for close
     const sp<ITunerCallback> mCallback;
 
     std::reference_wrapper<BroadcastRadio> mModule;
-    bool mIsTuneCompleted = false;
-    ProgramSelector mCurrentProgram = {};
-    std::thread* mRdsUpdateThread = nullptr; // add for rds update periodically
-    ProgramInfo mCurrentProgramInfo = {};// add for rds update filter
+    ProgramSelector mCurrentProgram = {}; // written under mMut and mRdsMut, read under either
+    std::unique_ptr<ParkedThread> mRdsUpdateThread; // add for rds update periodically
+    ProgramInfo mCurrentProgramInfo = {};// add for rds update filter, guarded by mRdsMut
+    ProgramInfoBuilder mInfoBuilder; // rds thread only, guarded by mRdsMut
+    std::map<uint64_t, uint16_t> mKnownPi; // freq -> last PI heard there, guarded by mRdsMut
+    AfFollower mAfFollower; // rds thread, guarded by mRdsMut
 
+    bool isOpen() const;
+    bool enterState(SessionState to);
+    bool beginClose();
+    void joinRdsThread();
     void cancelLocked();
-    void tuneInternalLocked(const ProgramSelector& sel);
+    uint64_t restoreJournaledSettings(TunerJournal::State* saved);
+    void addJournaledRds(const TunerJournal::State& saved, ProgramInfo* info);
+    void journalSettings();
+    void tuneInternalLocked(const ProgramSelector& sel,
+                            const TunerJournal::State* saved = nullptr,
+                            bool rdsLocked = false);
     const VirtualRadio& virtualRadio() const;
     const BroadcastRadio& module() const;
     void rdsUpdateThreadLoop();
-    bool isRdsUpdateNeeded(ProgramInfo& info);
-    void makeDummyProgramInfoForRdsUpdate(ProgramInfo* newInfo, const ProgramSelector& selector); // add for rds update
+    const ProgramInfo& readRdsProgramInfo(std::chrono::steady_clock::time_point arrived,
+                                          uint16_t* events); // add for rds update
+    void followAlternativeFrequency();
     // add for hal implements
     bool setRdsOnOff(bool rdsOn);
-    int mSpacing = 100;
-   public:
-    static const int RDS_EVENT_PROGRAMNAME = 0x0008;
-    static const int RDS_EVENT_LAST_RADIOTEXT = 0x0040;
-    static const int RDS_EVENT_AF = 0x0080;
+    // read by getParameters without locks, so it never waits behind a scan or seek
+    std::atomic<int> mSpacing{100};
+    std::atomic<int> mAntenna{0};
+    std::atomic<int> mChipId{-1}; // doesn't change, read on first idle query
+    std::atomic<uint64_t> mTunedFreq{0}; // kHz, frequency of mCurrentProgram
+    // span of the *Window parameters
+    std::atomic<std::chrono::milliseconds> mSignalWindow{std::chrono::seconds(5)};
+
+    // vendor parameters, looked up by key in setParameters/getParameters
+    struct ParameterSetter {
+        const char* key;
+        int (TunerSession::*set)(const hidl_string& value);
+    };
+    // what one getParameters reply is answered from, so its keys agree with each other
+    struct ParameterReply {
+        bool sampled = false;
+        bool hasSignal = false;
+        SignalSample signal;
+    };
+    struct ParameterGetter {
+        const char* key;
+        std::string (TunerSession::*get)(ParameterReply& reply);
+    };
+    static const ParameterSetter kParameterSetters[];
+    static const ParameterGetter kParameterGetters[];
+    int setSpacingParameter(const hidl_string& value);
+    int setAntennaParameter(const hidl_string& value);
+    int stopScanParameter(const hidl_string& value);
+    int setRdsParameter(const hidl_string& value);
+    int setSignalPeriodParameter(const hidl_string& value);
+    int setSignalWindowParameter(const hidl_string& value);
+    const SignalSample* replySignal(ParameterReply& reply);
+    int queryIdleChip(int (*query)());
+    std::string getRssiParameter(ParameterReply& reply);
+    std::string getSnrParameter(ParameterReply& reply);
+    std::string getBlerParameter(ParameterReply& reply);
+    std::string getStereoParameter(ParameterReply& reply);
+    std::string getChipIdParameter(ParameterReply& reply);
+    std::string getFreqParameter(ParameterReply& reply);
+    std::string getSpacingParameter(ParameterReply& reply);
+    std::string getAntennaParameter(ParameterReply& reply);
+    std::string getSignalPeriodParameter(ParameterReply& reply);
+    std::string getRssiWindowParameter(ParameterReply& reply);
+    std::string getSnrWindowParameter(ParameterReply& reply);
+    std::string getBlerWindowParameter(ParameterReply& reply);
+    std::string getTaskDelaysParameter(ParameterReply& reply);
+    std::string getAnnouncementLatencyParameter(ParameterReply& reply);
 };
 
 }  // namespace implementation
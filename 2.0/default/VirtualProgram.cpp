@@ -23,6 +23,8 @@
 #include <broadcastradio-utils-2x/Utils.h>
 #include <log/log.h>
 
+#include <algorithm>
+
 namespace vendor {
 namespace sprd {
 namespace hardware {
@@ -93,7 +95,8 @@ VirtualProgram::operator ProgramInfo() const {
 
     info.vendorInfo = hidl_vec<VendorKeyValue>({
         {"com.google.dummy", "dummy"},
-        {"com.google.dummy.VirtualProgram", std::to_string(reinterpret_cast<uintptr_t>(this))},
+        // stable across copies, the info is cached along with the program
+        {"com.google.dummy.VirtualProgram", toString(selector.primaryId)},
     });
 
     return info;
@@ -110,6 +113,23 @@ bool operator<(const VirtualProgram& lhs, const VirtualProgram& rhs) {
     return false;
 }
 
+size_t listChunkCount(size_t count) {
+    return count == 0 ? 1 : (count + kListChunkSize - 1) / kListChunkSize;
+}
+
+ProgramListChunk makeListChunk(const std::vector<ProgramInfo>& infos, size_t n) {
+    size_t pos = std::min(n * kListChunkSize, infos.size());
+    size_t end = std::min(pos + kListChunkSize, infos.size());
+
+    ProgramListChunk chunk = {};
+    chunk.purge = n == 0;
+    chunk.complete = end == infos.size();
+    if (end > pos) {
+        chunk.modified.setToExternal(const_cast<ProgramInfo*>(&infos[pos]), end - pos);
+    }
+    return chunk;
+}
+
 }  // namespace implementation
 }  // namespace V2_0
 }  // namespace broadcastradio
@@ -18,6 +18,8 @@
 
 #include <android/hardware/broadcastradio/2.0/types.h>
 
+#include <vector>
+
 namespace vendor {
 namespace sprd {
 namespace hardware {
@@ -50,6 +52,18 @@ struct VirtualProgram {
     friend bool operator<(const VirtualProgram& lhs, const VirtualProgram& rhs);
 };
 
+/** Program list entries per onProgramListUpdated, a tune result may go between two chunks. */
+constexpr size_t kListChunkSize = 20;
+
+/** Number of chunks a program list of count entries is sent in, one even for an empty list. */
+size_t listChunkCount(size_t count);
+
+/**
+ * Chunk n of the program list update carrying infos: up to kListChunkSize entries pointing
+ * into infos, which must outlive it. The first chunk purges, the last one is complete.
+ */
+ProgramListChunk makeListChunk(const std::vector<ProgramInfo>& infos, size_t n);
+
 }  // namespace implementation
 }  // namespace V2_0
 }  // namespace broadcastradio
@@ -21,6 +21,8 @@
 #include <broadcastradio-utils-2x/Utils.h>
 #include <log/log.h>
 
+#include <algorithm>
+
 namespace vendor {
 namespace sprd {
 namespace hardware {
@@ -31,9 +33,7 @@ namespace implementation {
 using namespace android::hardware::broadcastradio::utils;
 using namespace android::hardware::broadcastradio;
 
-using std::lock_guard;
 using std::move;
-using std::mutex;
 using std::vector;
 
 
@@ -49,27 +49,192 @@ VirtualRadio gAmFmRadio(
         {make_selector_amfm(106100), "106 KMEL", "Drake", "Marvins Room"},
     });
 
+static bool indexLess(uint32_t lType, uint64_t lValue, uint32_t rType, uint64_t rValue) {
+    return lType != rType ? lType < rType : lValue < rValue;
+}
+
+static bool sameProgram(const VirtualProgram& l, const VirtualProgram& r) {
+    return l.selector == r.selector && l.programName == r.programName &&
+           l.songArtist == r.songArtist && l.songTitle == r.songTitle;
+}
+
 VirtualRadio::VirtualRadio(const std::string& name, const vector<VirtualProgram>& initialList)
-    : mName(name), mPrograms(initialList) {}
+    : mName(name) {
+    std::lock_guard<std::mutex> lk(mWriteMut);
+    publishLocked(vector<VirtualProgram>(initialList));
+}
 
 std::string VirtualRadio::getName() const {
     return mName;
 }
 
+std::shared_ptr<const VirtualRadio::Snapshot> VirtualRadio::snapshot() const {
+    return std::atomic_load(&mSnapshot);
+}
+
 vector<VirtualProgram> VirtualRadio::getProgramList() const {
-    lock_guard<mutex> lk(mMut);
-    return mPrograms;
+    return snapshot()->programs;
 }
 
 bool VirtualRadio::getProgram(const ProgramSelector& selector, VirtualProgram& programOut) const {
-    lock_guard<mutex> lk(mMut);
-    for (auto&& program : mPrograms) {
-        if (utils::tunesTo(selector, program.selector)) {
-            programOut = program;
-            return true;
+    auto snap = snapshot();
+    auto program = snap->find(selector);
+    if (program == nullptr) return false;
+
+    programOut = *program;
+    return true;
+}
+
+void VirtualRadio::setProgram(const VirtualProgram& program) {
+    std::lock_guard<std::mutex> lk(mWriteMut);
+    auto programs = mSnapshot->programs;
+    auto it = std::find_if(programs.begin(), programs.end(), [&](const VirtualProgram& p) {
+        return p.selector.primaryId == program.selector.primaryId;
+    });
+    if (it != programs.end()) {
+        if (sameProgram(*it, program)) return;
+        *it = program;
+    } else {
+        programs.push_back(program);
+    }
+    publishLocked(move(programs));
+}
+
+bool VirtualRadio::removeProgram(const ProgramIdentifier& primaryId) {
+    std::lock_guard<std::mutex> lk(mWriteMut);
+    auto programs = mSnapshot->programs;
+    auto it = std::find_if(programs.begin(), programs.end(), [&](const VirtualProgram& p) {
+        return p.selector.primaryId == primaryId;
+    });
+    if (it == programs.end()) return false;
+
+    programs.erase(it);
+    publishLocked(move(programs));
+    return true;
+}
+
+bool VirtualRadio::setProgramText(const ProgramIdentifier& primaryId, const std::string& name,
+                                  const std::string& artist, const std::string& title) {
+    std::lock_guard<std::mutex> lk(mWriteMut);
+    auto& current = mSnapshot->programs;
+    auto it = std::find_if(current.begin(), current.end(), [&](const VirtualProgram& p) {
+        return p.selector.primaryId == primaryId;
+    });
+    if (it == current.end()) return false;
+    if (it->programName == name && it->songArtist == artist && it->songTitle == title) {
+        return true;
+    }
+
+    auto programs = current;
+    auto& program = programs[it - current.begin()];
+    program.programName = name;
+    program.songArtist = artist;
+    program.songTitle = title;
+    publishLocked(move(programs));
+    return true;
+}
+
+void VirtualRadio::setProgramList(const vector<VirtualProgram>& programs) {
+    std::lock_guard<std::mutex> lk(mWriteMut);
+    publishLocked(vector<VirtualProgram>(programs));
+}
+
+void VirtualRadio::publishLocked(vector<VirtualProgram>&& programs) {
+    auto snap = std::make_shared<Snapshot>();
+    snap->programs = move(programs);
+    snap->generation = mSnapshot ? mSnapshot->generation + 1 : 0;
+
+    // only programs the mutation touched are converted again
+    snap->infos.reserve(snap->programs.size());
+    for (auto&& program : snap->programs) {
+        auto old = mSnapshot ? mSnapshot->findPrimary(program.selector.primaryId) : nullptr;
+        if (old != nullptr && sameProgram(*old, program)) {
+            snap->infos.push_back(mSnapshot->infos[old - mSnapshot->programs.data()]);
+        } else {
+            snap->infos.push_back(program);
+        }
+    }
+
+    auto& index = snap->index;
+    for (uint32_t i = 0; i < snap->programs.size(); i++) {
+        auto& sel = snap->programs[i].selector;
+        index.push_back({sel.primaryId.type, sel.primaryId.value, i});
+        for (auto&& id : sel.secondaryIds) {
+            index.push_back({id.type, id.value, i});
+        }
+    }
+    std::sort(index.begin(), index.end(), [](const IndexEntry& l, const IndexEntry& r) {
+        if (l.type != r.type || l.value != r.value) {
+            return indexLess(l.type, l.value, r.type, r.value);
+        }
+        return l.program < r.program;
+    });
+
+    std::atomic_store(&mSnapshot, std::shared_ptr<const Snapshot>(move(snap)));
+    ALOGV("%s: %s generation %llu", __func__, mName.c_str(),
+          static_cast<unsigned long long>(mSnapshot->generation));
+}
+
+/*
+ * tunesTo needs the two selectors to share at least one identifier, so only programs
+ * indexed under one of the identifiers of selector can match; those are verified with
+ * tunesTo itself, which keeps the matching rules in one place.
+ */
+const VirtualProgram* VirtualRadio::Snapshot::find(const ProgramSelector& selector) const {
+    uint32_t best = UINT32_MAX;
+
+    // lowers best to the first program indexed under id that selector tunes to
+    auto lookup = [&](const ProgramIdentifier& id) {
+        auto range = std::equal_range(
+            index.begin(), index.end(), IndexEntry{id.type, id.value, 0},
+            [](const IndexEntry& l, const IndexEntry& r) {
+                return indexLess(l.type, l.value, r.type, r.value);
+            });
+        // entries of one identifier are in program order
+        for (auto it = range.first; it != range.second && it->program < best; ++it) {
+            if (utils::tunesTo(selector, programs[it->program].selector)) {
+                best = it->program;
+                return;
+            }
+        }
+    };
+
+    lookup(selector.primaryId);
+    for (auto&& id : selector.secondaryIds) {
+        lookup(id);
+    }
+    return best == UINT32_MAX ? nullptr : &programs[best];
+}
+
+// primary identifiers are unique within a snapshot, so a program is found by its own
+const VirtualProgram* VirtualRadio::Snapshot::findPrimary(const ProgramIdentifier& id) const {
+    auto range = std::equal_range(
+        index.begin(), index.end(), IndexEntry{id.type, id.value, 0},
+        [](const IndexEntry& l, const IndexEntry& r) {
+            return indexLess(l.type, l.value, r.type, r.value);
+        });
+    for (auto it = range.first; it != range.second; ++it) {
+        auto& program = programs[it->program];
+        if (program.selector.primaryId == id) return &program;
+    }
+    return nullptr;
+}
+
+void VirtualRadio::diff(const Snapshot& from, const Snapshot& to,
+                        vector<VirtualProgram>* modified, vector<ProgramIdentifier>* removed) {
+    modified->clear();
+    removed->clear();
+    if (from.generation == to.generation) return;
+
+    for (auto&& program : to.programs) {
+        auto old = from.findPrimary(program.selector.primaryId);
+        if (old == nullptr || !sameProgram(*old, program)) modified->push_back(program);
+    }
+    for (auto&& program : from.programs) {
+        if (to.findPrimary(program.selector.primaryId) == nullptr) {
+            removed->push_back(program.selector.primaryId);
         }
     }
-    return false;
 }
 
 }  // namespace implementation
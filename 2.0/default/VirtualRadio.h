@@ -18,6 +18,7 @@
 
 #include "VirtualProgram.h"
 
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -36,19 +37,69 @@ namespace implementation {
  * not a captured station list in the radio tuner memory.
  *
  * It's meant to abstract out radio content from default tuner implementation.
+ *
+ * Programs live in an immutable snapshot shared by all readers, along with their
+ * ProgramInfo, which a program list chunk can point at instead of converting again. Mutations build a new
+ * snapshot (list and index) and publish it atomically, so readers never lock nor copy:
+ * whoever holds a snapshot keeps seeing a consistent list while the air changes, Eg.
+ * stations fading in and out while driving between cities. Lookups go through a flat
+ * index of every identifier of every program, sorted by type and value, and stay
+ * logarithmic for generated spaces of thousands of programs.
  */
 class VirtualRadio {
    public:
+    struct IndexEntry {
+        uint32_t type;
+        uint64_t value;
+        uint32_t program;  // position in programs
+    };
+
+    struct Snapshot {
+        std::vector<VirtualProgram> programs;
+        std::vector<ProgramInfo> infos;  // programs[i] as sent to clients, built once
+        std::vector<IndexEntry> index;   // sorted by (type, value, program)
+        uint64_t generation;             // bumped by every mutation
+
+        /** First program of the list selector tunes to, same match as utils::tunesTo. */
+        const VirtualProgram* find(const ProgramSelector& selector) const;
+        /** Program of that primary identifier, nullptr if there is none. */
+        const VirtualProgram* findPrimary(const ProgramIdentifier& primaryId) const;
+    };
+
     VirtualRadio(const std::string& name, const std::vector<VirtualProgram>& initialList);
 
     std::string getName() const;
+    /** Current snapshot, stays valid and unchanged for as long as it's held. */
+    std::shared_ptr<const Snapshot> snapshot() const;
     std::vector<VirtualProgram> getProgramList() const;
     bool getProgram(const ProgramSelector& selector, VirtualProgram& program) const;
+    size_t size() const { return snapshot()->programs.size(); }
+
+    /** Adds a program, or replaces the one with the same primary identifier. */
+    void setProgram(const VirtualProgram& program);
+    /** @Result: false if no program has that primary identifier. */
+    bool removeProgram(const ProgramIdentifier& primaryId);
+    /** Replaces the rds content of a program; false if there is no such program. */
+    bool setProgramText(const ProgramIdentifier& primaryId, const std::string& name,
+                        const std::string& artist, const std::string& title);
+    /** Replaces the whole list in one step. */
+    void setProgramList(const std::vector<VirtualProgram>& programs);
+
+    /**
+     * Changes between two snapshots, as an incremental program list update carries them:
+     * programs new in or changed by to, and primary identifiers of programs gone from it.
+     */
+    static void diff(const Snapshot& from, const Snapshot& to,
+                     std::vector<VirtualProgram>* modified,
+                     std::vector<ProgramIdentifier>* removed);
 
    private:
-    mutable std::mutex mMut;
-    std::string mName;
-    std::vector<VirtualProgram> mPrograms;
+    const std::string mName;
+    std::shared_ptr<const Snapshot> mSnapshot;  // atomic_load/atomic_store only
+    std::mutex mWriteMut;                       // serializes mutations
+
+    // publishes programs as the next snapshot, mWriteMut held
+    void publishLocked(std::vector<VirtualProgram>&& programs);
 };
 
 /** AM/FM virtual radio space. */
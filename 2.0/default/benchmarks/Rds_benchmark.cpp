@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../ProgramInfoBuilder.h"
+
+#include <benchmark/benchmark.h>
+#include <broadcastradio-utils-2x/Utils.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+using namespace vendor::sprd::hardware::broadcastradio::V2_0::implementation;
+using namespace android::hardware::broadcastradio;
+
+static constexpr uint16_t kTextEvents =
+    RDS_EVENT_PROGRAMNAME | RDS_EVENT_LAST_RADIOTEXT | RDS_EVENT_PTY_CODE;
+static constexpr uint16_t kAllEvents = kTextEvents | RDS_EVENT_PI_CODE | RDS_EVENT_FLAGS;
+
+// an rds block as the driver fills it, with padding and a control char in the texts
+static RDSData_Struct makeRds(const char* ps, const char* rt) {
+    RDSData_Struct rds;
+    memset(&rds, 0, sizeof(rds));
+    rds.PI = 0xC201;
+    rds.PTY = 10;
+    rds.RDSFlag.Stereo = 1;
+    rds.RDSFlag.TP = 1;
+    memset(rds.PS_Data.PS[3], ' ', sizeof(rds.PS_Data.PS[3]));
+    memcpy(rds.PS_Data.PS[3], ps, std::min(strlen(ps), sizeof(rds.PS_Data.PS[3])));
+    memset(rds.RT_Data.TextData[3], ' ', sizeof(rds.RT_Data.TextData[3]));
+    memcpy(rds.RT_Data.TextData[3], rt, std::min(strlen(rt), sizeof(rds.RT_Data.TextData[3])));
+    rds.RT_Data.TextData[3][40] = 0x0d;
+    rds.RT_Data.TextLength = sizeof(rds.RT_Data.TextData[3]);
+    rds.event_status = kAllEvents;
+    return rds;
+}
+
+static void BM_ComGetPs(benchmark::State& state) {
+    RDSData_Struct rds = makeRds("RADIO 1", "");
+
+    for (auto _ : state) {
+        uint8_t* ps = nullptr;
+        int len = 0;
+        benchmark::DoNotOptimize(COM_get_ps(0, &rds, &ps, &len));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComGetPs);
+
+static void BM_ComGetRt(benchmark::State& state) {
+    RDSData_Struct rds = makeRds("", "Now playing: The Long Artist Name - A Song Title");
+
+    for (auto _ : state) {
+        uint8_t* rt = nullptr;
+        int len = 0;
+        benchmark::DoNotOptimize(COM_get_rt(0, &rds, &rt, &len));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComGetRt);
+
+// one rds round of the session: the text flips between two songs every read
+static void BM_BuildProgramInfo(benchmark::State& state) {
+    const RDSData_Struct rds[2] = {makeRds("RADIO 1", "Now playing: First Song"),
+                                   makeRds("RADIO 1", "Now playing: Second Song")};
+    uint16_t events = state.range(0);
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    size_t i = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&builder.update(rds[i++ & 1], events, 60));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BuildProgramInfo)->Arg(0)->Arg(kTextEvents)->Arg(kAllEvents);
+
+// the callback filter, range(0) 0: nothing changed, the costliest answer; 1: text changed
+static void BM_IsRdsUpdateNeeded(benchmark::State& state) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    ProgramInfo current = builder.update(makeRds("RADIO 1", "First Song"), kAllEvents, 60);
+    ProgramInfo next = state.range(0) == 0
+                           ? current
+                           : builder.update(makeRds("RADIO 1", "Second Song"), kAllEvents, 60);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(isRdsUpdateNeeded(next, current));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsRdsUpdateNeeded)->Arg(0)->Arg(1);
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../SignalMonitor.h"
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+/*
+ * Native side of the signal getters. The JNI transition itself (regular vs
+ * @FastNative vs @CriticalNative) is measured on the device from the Java side; these
+ * cover what each getter does once called.
+ */
+
+// an ioctl round trip, roughly
+static bool slowSampler(SignalSample* sample) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    sample->rssi = -70;
+    sample->snr = 20;
+    sample->bler = 0;
+    return true;
+}
+
+// getRssi: newest sample, refreshed from the chip when stale
+static void BM_SignalLatest(benchmark::State& state) {
+    SignalMonitor monitor(slowSampler);
+    monitor.start();
+
+    for (auto _ : state) {
+        SignalSample sample;
+        benchmark::DoNotOptimize(monitor.latest(&sample));
+    }
+    monitor.stop();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SignalLatest);
+
+// getRssiCritical: newest sample as is, never to the chip
+static void BM_SignalNewest(benchmark::State& state) {
+    SignalMonitor monitor(slowSampler);
+    monitor.start();
+
+    for (auto _ : state) {
+        SignalSample sample;
+        benchmark::DoNotOptimize(monitor.newest(&sample));
+    }
+    monitor.stop();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SignalNewest);
+
+// a meter polling right after tunes: no valid sample, every call goes to the chip
+static void BM_SignalLatestInvalidated(benchmark::State& state) {
+    SignalMonitor monitor(slowSampler);
+
+    for (auto _ : state) {
+        SignalSample sample;
+        monitor.invalidate();
+        benchmark::DoNotOptimize(monitor.latest(&sample));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SignalLatestInvalidated);
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../SyntheticSpectrum.h"
+#include "../VirtualRadio.h"
+
+#include <benchmark/benchmark.h>
+#include <broadcastradio-utils-2x/Utils.h>
+
+#include <algorithm>
+
+using namespace vendor::sprd::hardware::broadcastradio::V2_0::implementation;
+using namespace android::hardware::broadcastradio;
+using android::hardware::hidl_vec;
+
+static constexpr uint32_t kSeed = 20171019;
+
+// the programs spread over the four kinds, range(0) in total
+static std::vector<VirtualProgram> makePrograms(int64_t count) {
+    SpectrumSpec spec;
+    spec.fm = count * 4 / 10;
+    spec.am = count * 2 / 10;
+    spec.hd = count * 2 / 10;
+    spec.dab = count - spec.fm - spec.am - spec.hd;
+    return generateSpectrum(spec, kSeed);
+}
+
+// selectors as a client builds them: the primary identifier only
+static std::vector<ProgramSelector> makeQueries(const std::vector<VirtualProgram>& programs) {
+    std::vector<ProgramSelector> queries;
+    for (size_t i = 0; i < programs.size(); i += 7) {
+        ProgramSelector sel = {};
+        sel.primaryId = programs[i].selector.primaryId;
+        queries.push_back(sel);
+    }
+    return queries;
+}
+
+static void BM_GetProgram(benchmark::State& state) {
+    auto programs = makePrograms(state.range(0));
+    VirtualRadio radio("benchmark", programs);
+    auto queries = makeQueries(programs);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        VirtualProgram program;
+        benchmark::DoNotOptimize(radio.getProgram(queries[i++ % queries.size()], program));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetProgram)->RangeMultiplier(10)->Range(100, 10000);
+
+// what getProgram did before the index, for comparison
+static void BM_GetProgramLinear(benchmark::State& state) {
+    auto programs = makePrograms(state.range(0));
+    auto queries = makeQueries(programs);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto& query = queries[i++ % queries.size()];
+        auto it = std::find_if(programs.begin(), programs.end(), [&](const VirtualProgram& p) {
+            return utils::tunesTo(query, p.selector);
+        });
+        benchmark::DoNotOptimize(it);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetProgramLinear)->RangeMultiplier(10)->Range(100, 10000);
+
+// a full program list as sent by onProgramListUpdated, out of the cached infos
+static void BM_MaterializeProgramList(benchmark::State& state) {
+    VirtualRadio radio("benchmark", makePrograms(state.range(0)));
+
+    for (auto _ : state) {
+        auto snap = radio.snapshot();
+        hidl_vec<ProgramInfo> infos;
+        infos.setToExternal(const_cast<ProgramInfo*>(snap->infos.data()), snap->infos.size());
+        benchmark::DoNotOptimize(infos.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MaterializeProgramList)->RangeMultiplier(10)->Range(100, 10000);
+
+// the same list converted program by program, as before the cache
+static void BM_ConvertProgramList(benchmark::State& state) {
+    VirtualRadio radio("benchmark", makePrograms(state.range(0)));
+
+    for (auto _ : state) {
+        auto snap = radio.snapshot();
+        hidl_vec<ProgramInfo> infos(snap->programs.begin(), snap->programs.end());
+        benchmark::DoNotOptimize(infos.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConvertProgramList)->RangeMultiplier(10)->Range(100, 10000);
+
+// the chunks startProgramListUpdates sends: the list converted once, chunks point into it
+static void BM_BuildListChunks(benchmark::State& state) {
+    auto programs = makePrograms(state.range(0));
+
+    for (auto _ : state) {
+        auto infos =
+            std::make_shared<const std::vector<ProgramInfo>>(programs.begin(), programs.end());
+        for (size_t n = 0, count = listChunkCount(infos->size()); n < count; n++) {
+            ProgramListChunk chunk = makeListChunk(*infos, n);
+            benchmark::DoNotOptimize(chunk.modified.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildListChunks)->RangeMultiplier(10)->Range(100, 10000);
+
+// one station changes its rds text, and the incremental update a session sends for it
+static void BM_ChurnProgramText(benchmark::State& state) {
+    auto programs = makePrograms(state.range(0));
+    VirtualRadio radio("benchmark", programs);
+    std::vector<VirtualProgram> modified;
+    std::vector<ProgramIdentifier> removed;
+    size_t i = 0;
+
+    for (auto _ : state) {
+        auto before = radio.snapshot();
+        auto& id = programs[i % programs.size()].selector.primaryId;
+        radio.setProgramText(id, "Churn", "Artist " + std::to_string(i), "Title");
+        VirtualRadio::diff(*before, *radio.snapshot(), &modified, &removed);
+        benchmark::DoNotOptimize(modified.data());
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ChurnProgramText)->RangeMultiplier(10)->Range(100, 10000);
+
+// lookups while another thread keeps moving stations in and out of the air
+static void BM_GetProgramUnderChurn(benchmark::State& state) {
+    static const auto programs = makePrograms(1000);
+    static const auto queries = makeQueries(programs);
+    // other threads only touch it inside the loop, past the start barrier
+    static VirtualRadio* radio;
+    if (state.thread_index == 0) {
+        radio = new VirtualRadio("benchmark", programs);
+    }
+    size_t i = 0;
+
+    for (auto _ : state) {
+        if (state.thread_index == 0) {
+            auto& program = programs[i++ % programs.size()];
+            radio->removeProgram(program.selector.primaryId);
+            radio->setProgram(program);
+        } else {
+            VirtualProgram program;
+            benchmark::DoNotOptimize(radio->getProgram(queries[i++ % queries.size()], program));
+        }
+    }
+    if (state.thread_index == 0) {
+        delete radio;
+        radio = nullptr;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetProgramUnderChurn)->ThreadRange(2, 8);
+
+static void BM_GenerateSpectrum(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(makePrograms(state.range(0)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GenerateSpectrum)->RangeMultiplier(10)->Range(100, 10000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../fmr.h"
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+extern struct fmr_ds fmr_data;
+
+/*
+ * fmr_core on a simulated chip: the callback table answers from a fixed station list,
+ * so seek/scan cost the core logic only, without /dev/fm.
+ */
+
+// on the 100kHz raster, same list on every run
+static const std::vector<int>& simStations() {
+    static const std::vector<int> stations = [] {
+        std::mt19937 rng(20171019);
+        std::vector<int> list;
+        for (int freq = 7600; freq <= 10800; freq += 10) {
+            if (rng() % 6 == 0) list.push_back(freq);
+        }
+        return list;
+    }();
+    return stations;
+}
+
+// channel the chip sits on, a seek stops on the station it finds
+static int g_simFreq = 8750;
+
+// hardware seek: the next station from *freq, wrapping around the band like the chip
+static int simSeek(int /* fd */, int* freq, int /* band */, int dir, int /* lev */) {
+    const auto& stations = simStations();
+    // dir 0 is up for the fmr core, see FMR_seek
+    if (dir == 0) {
+        auto it = std::lower_bound(stations.begin(), stations.end(), *freq);
+        *freq = it != stations.end() ? *it : stations.front();
+    } else {
+        auto it = std::upper_bound(stations.begin(), stations.end(), *freq);
+        *freq = it != stations.begin() ? *(it - 1) : stations.back();
+    }
+    g_simFreq = *freq;
+    return 0;
+}
+
+// -110..-51, so fm.conf's -102 threshold drops a few stations
+static int simGetRssi(int /* fd */, int* rssi) {
+    *rssi = -110 + (g_simFreq * 7) % 60;
+    return 0;
+}
+
+// a spur every 8MHz
+static int simDesenseCheck(int /* fd */, int freq, int /* rssi */) {
+    return freq % 800 == 0 ? 1 : 0;
+}
+
+static int simTune(int /* fd */, int freq, int /* band */) {
+    g_simFreq = freq;
+    return 0;
+}
+
+static int simFd(int /* fd */) {
+    return 0;
+}
+
+static void simInterfaceInit(struct fm_cbk_tbl* tbl) {
+    tbl->seek = simSeek;
+    tbl->get_rssi = simGetRssi;
+    tbl->desense_check = simDesenseCheck;
+    tbl->tune = simTune;
+    tbl->stop_scan = simFd;
+    tbl->pre_search = simFd;
+    tbl->restore_search = simFd;
+}
+
+static int simIdx() {
+    static const int idx = FMR_init_ex(simInterfaceInit);
+    return idx;
+}
+
+static int bandMin(int band) {
+    return band == FM_BAND_UE ? 8750 : 7600;
+}
+
+static int bandMax(int band) {
+    return band == FM_BAND_JAPAN ? 9600 : 10800;
+}
+
+// {band, spacing in 10kHz}, as fm.conf allows them
+static void bandAndSpacing(benchmark::internal::Benchmark* b) {
+    for (int band : {FM_BAND_UE, FM_BAND_JAPAN, FM_BAND_JAPANW}) {
+        for (int spacing : {5, 10, 20}) {
+            b->Args({band, spacing});
+        }
+    }
+}
+
+// one hardware seek from each channel of the band in turn
+static void BM_Seek(benchmark::State& state) {
+    int idx = simIdx();
+    int band = state.range(0);
+    int spacing = state.range(1);
+    int freq = bandMin(band);
+    int dir = 1;
+
+    fmr_data.cfg_data.band = band;
+    for (auto _ : state) {
+        int ret_freq = 0;
+        benchmark::DoNotOptimize(FMR_seek(idx, freq, dir, &ret_freq, spacing));
+        freq += spacing;
+        if (freq > bandMax(band)) {
+            freq = bandMin(band);
+            dir = !dir;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Seek)->Apply(bandAndSpacing);
+
+// a full band scan into a table, sorted as the client gets it; the scan always sweeps
+// 87.5-108MHz whatever the band, so only spacing varies
+static void BM_Scan(benchmark::State& state) {
+    int idx = simIdx();
+    int spacing = state.range(0);
+    int table[CQI_CH_NUM_MAX];
+    int num = 0;
+
+    fmr_data.cfg_data.band = FM_BAND_UE;
+    for (auto _ : state) {
+        num = CQI_CH_NUM_MAX;
+        benchmark::DoNotOptimize(FMR_scan_range(idx, table, &num, 0, 0, spacing));
+    }
+    state.counters["stations"] = num;
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Scan)->Arg(5)->Arg(10)->Arg(20);
+
+static const char kConfig[] =
+    "# benchmark copy of fm.conf\n"
+    "chip\t\t= 26152\t\t# 2351 -> 1; marlin -> 2\n"
+    "band\t\t= 1\t\t# 1, UE; 2, JAPAN; 3, JAPANW\n"
+    "low band\t= 875\t\t# min frequence\n"
+    "high band\t= 1080\t\t# max frequence\n"
+    "seek space\t= 1\n"
+    "max scan num\t= 40\n"
+    "seek level\t= 4\n"
+    "scan sort\t= 0\n"
+    "short antenna support\t= 0\n"
+    "rssi threshold \t= -102\n";
+
+// fm.conf with count fake channels, in the first writable temp dir; empty on failure
+static std::string writeConfig(int count) {
+    const char* dirs[] = {getenv("TMPDIR"), "/data/local/tmp", "/tmp"};
+
+    for (const char* dir : dirs) {
+        if (dir == nullptr) continue;
+        std::string path = std::string(dir) + "/fm_conf_XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0) continue;
+        FILE* fp = fdopen(fd, "w");
+        fputs(kConfig, fp);
+        for (int i = 0; i < count; i++) {
+            fprintf(fp, "fake channel = %d;%d;1\n", 8750 + 10 * i, -95);
+        }
+        fclose(fp);
+        return path;
+    }
+    return "";
+}
+
+// FMR_get_cfgs/FMR_reload_tunables parse fm.conf like this, at init and on each reload
+static void BM_ParseConfig(benchmark::State& state) {
+    std::string path = writeConfig(state.range(0));
+    if (path.empty()) {
+        state.SkipWithError("no writable temp dir");
+        return;
+    }
+    struct fm_fake_channel chans[FMR_MAX_FAKE_CHN_NUM];
+    struct fm_fake_channel_t fake;
+    struct CUST_cfg_ds cfg;
+
+    for (auto _ : state) {
+        memset(&cfg, 0, sizeof(cfg));
+        fake.size = 0;
+        fake.chan = chans;
+        cfg.fake_chan = &fake;
+        benchmark::DoNotOptimize(FMR_parse_cfgs(path.c_str(), &cfg));
+    }
+    unlink(path.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseConfig)->Arg(0)->Arg(10)->Arg(FMR_MAX_FAKE_CHN_NUM);
+
+// the fake channel lookup each scanned station goes through
+static void BM_SevereDesense(benchmark::State& state) {
+    struct fmr_tunables tun;
+    int freq = 8750;
+
+    for (int i = 0; i < state.range(0); i++) {
+        tun.fake[tun.fake_num++] = {8750 + 40 * i, -95, 1};
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FMR_SevereDensense(&tun, freq, -100));
+        freq = freq < 10800 ? freq + 10 : 8750;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SevereDesense)->Arg(0)->Arg(10)->Arg(FMR_MAX_FAKE_CHN_NUM);
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
 #include "fmr.h"
 
 #ifdef LOG_TAG
@@ -57,6 +58,7 @@ int COM_close_dev(int fd)
 
 int COM_pwr_up(int fd, int band, int freq)
 {
+    FMR_SPAN("ioctl POWERUP", freq);
     int ret = 0;
     struct fm_tune_parm parm;
 
@@ -133,9 +135,9 @@ int COM_get_ps(int fd, RDSData_Struct *rds, uint8_t **ps, int *ps_len)
 
         COM_change_string(*ps, *ps_len);
         memcpy(tmp_ps, *ps, 8);
-        LOGI("PS=%s\n", tmp_ps);
+        LOGD("PS=%s\n", tmp_ps);
     } else {
-        LOGE("%s, Failed,[event_status=%d]\n", __func__, rds->event_status);
+        FMR_TRACE(TR_RDS_MISSING, 0, rds->event_status);
         *ps = NULL;
         *ps_len = 0;
         ret = -ERR_RDS_NO_DATA;
@@ -160,9 +162,9 @@ int COM_get_rt(int fd, RDSData_Struct *rds, uint8_t **rt, int *rt_len)
 
         COM_change_string(*rt, *rt_len);
         memcpy(tmp_rt, *rt, 64);
-        LOGI("RT=%s\n", tmp_rt);
+        LOGD("RT=%s\n", tmp_rt);
     } else {
-        LOGE("%s, Failed,[event_status=%d]\n", __func__, rds->event_status);
+        FMR_TRACE(TR_RDS_MISSING, 1, rds->event_status);
         *rt = NULL;
         *rt_len = 0;
         ret = -ERR_RDS_NO_DATA;
@@ -181,7 +183,7 @@ int COM_get_pi(int fd, RDSData_Struct *rds, uint16_t *pi)
         LOGD("%s, Success,[event_status=%d] [PI=%d]\n", __func__, rds->event_status, rds->PI);
         *pi = rds->PI;
     } else {
-        LOGI("%s, Failed, there's no pi,[event_status=%d]\n", __func__, rds->event_status);
+        FMR_TRACE(TR_RDS_MISSING, 2, rds->event_status);
         *pi = -1;
         ret = -ERR_RDS_NO_DATA;
     }
@@ -191,6 +193,7 @@ int COM_get_pi(int fd, RDSData_Struct *rds, uint16_t *pi)
 
 int COM_tune(int fd, int freq, int band)
 {
+    FMR_SPAN("ioctl TUNE", freq);
     int ret = 0;
 
     struct fm_tune_parm parm;
@@ -212,6 +215,7 @@ int COM_tune(int fd, int freq, int band)
 
 int COM_seek(int fd, int *freq, int band, int dir, int lev)
 {
+    FMR_SPAN("ioctl SEEK", *freq);
     int ret = 0;
     struct fm_seek_parm parm;
 
@@ -238,6 +242,7 @@ int COM_seek(int fd, int *freq, int band, int dir, int lev)
 
 int COM_set_mute(int fd, int mute)
 {
+    FMR_SPAN("ioctl MUTE", mute);
     int ret = 0;
     int tmp = mute;
 
@@ -327,6 +332,7 @@ int COM_restore_search(int fd)
 /*soft mute tune function, usually for sw scan implement or CQI log tool*/
 int COM_Soft_Mute_Tune(int fd, fm_softmute_tune_t *para)
 {
+    FMR_SPAN("ioctl SOFT_MUTE_TUNE", para->freq);
     fm_s32 ret = 0;
     //fm_s32 RSSI = 0, PAMD = 0,MR = 0, ATDC = 0;
     //fm_u32 PRX = 0;
@@ -396,6 +402,7 @@ int COM_get_cqi(int fd, int num, char *buf, int buf_len)
 
 int COM_turn_on_off_rds(int fd, int onoff)
 {
+    FMR_SPAN("ioctl RDS_ONOFF", onoff);
     int ret = 0;
     uint16_t rds_on = -1;
 
@@ -438,6 +445,7 @@ int COM_get_chip_id(int fd, int *chipid)
 
 int COM_get_rssi(int fd, int *rssi)
 {
+    FMR_SPAN("ioctl GETRSSI");
     int ret = 0;
     int32_t tmp = 0;
 
@@ -579,6 +587,7 @@ int COM_rw_reg(int fd,fm_reg_ctl_parm *para)
 
 int COM_read_rds_data(int fd, RDSData_Struct *rds, uint16_t *rds_status)
 {
+    FMR_SPAN("read rds");
     int ret = 0;
     uint16_t event_status;
     //char tmp_ps[9] = {0};
@@ -591,7 +600,6 @@ int COM_read_rds_data(int fd, RDSData_Struct *rds, uint16_t *rds_status)
         event_status = rds->event_status;
         //memcpy(tmp_ps, &rds->PS_Data.PS[3][0], 8);
         //memcpy(tmp_rt, &rds->RT_Data.TextData[3][0], 64);
-        LOGI("event_status = 0x%x\n", event_status);
         //memset(tmp_ps, 0, 9);
         //memset(tmp_rt, 0, 65);
         *rds_status = event_status;
@@ -603,8 +611,86 @@ int COM_read_rds_data(int fd, RDSData_Struct *rds, uint16_t *rds_status)
     return ret;
 }
 
+/*  COM_wait_rds_event -- sleep until the driver has rds data to read
+  *  @fd - fd of "dev/fm"
+  *  @timeout_ms - longest time to sleep
+  *  return value: 1, data ready; 0, timed out; else error NO.
+  */
+int COM_wait_rds_event(int fd, int timeout_ms)
+{
+    FMR_SPAN("poll rds", timeout_ms);
+    int ret = 0;
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        LOGE("%s, failed, %s\n", __func__, strerror(errno));
+        return -ERR_INVALID_FD;
+    }
+    if (ret > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        LOGE("%s, [revents=0x%x]\n", __func__, pfd.revents);
+        return -ERR_INVALID_FD;
+    }
+    return ret > 0 ? 1 : 0;
+}
+
+/*  COM_get_pamd -- read the multipath (PAMD) level of current channel
+  *  @fd - fd of "dev/fm"
+  *  @pamd - the higher, the cleaner the channel is
+  *  return value: 0, success; else error NO.
+  */
+int COM_get_pamd(int fd, int *pamd)
+{
+    int ret = 0;
+    uint16_t tmp = 0;
+
+    FMR_ASSERT(pamd);
+
+    ret = ioctl(fd, FM_IOCTL_GETCURPAMD, &tmp);
+    *pamd = (int) tmp;
+
+    if (ret) {
+        LOGE("%s, failed\n", __func__);
+    }
+
+    LOGD("%s, [fd=%d] [pamd=%d] [ret=%d]\n", __func__, fd, *pamd, ret);
+
+    return ret;
+}
+
+/*  COM_get_stereo -- check if current channel is received in stereo
+  *  @fd - fd of "dev/fm"
+  *  @stereo - 1, stereo; 0, mono
+  *  return value: 0, success; else error NO.
+  */
+int COM_get_stereo(int fd, int *stereo)
+{
+    int ret = 0;
+    uint16_t tmp = 0;
+
+    FMR_ASSERT(stereo);
+
+    ret = ioctl(fd, FM_IOCTL_GETMONOSTERO, &tmp);
+    *stereo = (int) tmp;
+
+    if (ret) {
+        LOGE("%s, failed\n", __func__);
+    }
+
+    LOGD("%s, [fd=%d] [stereo=%d] [ret=%d]\n", __func__, fd, *stereo, ret);
+
+    return ret;
+}
+
 int COM_active_af(int fd, RDSData_Struct *rds, int band, uint16_t cur_freq, uint16_t *ret_freq)
 {
+    FMR_SPAN("active af sweep", cur_freq);
     int ret = 0;
     int i = 0;
     struct fm_tune_parm parm;
@@ -634,7 +720,7 @@ int COM_active_af(int fd, RDSData_Struct *rds, int band, uint16_t cur_freq, uint
     AF_PAMD_LBound = PAMD_DB_TBL[0]; //5dB
     AF_PAMD_HBound = PAMD_DB_TBL[1]; //15dB
     ioctl(fd, FM_IOCTL_GETCURPAMD, &PAMD_Value);
-    LOGI("current_freq=%d,PAMD_Value=%d\n", cur_freq, PAMD_Value);
+    LOGD("current_freq=%d,PAMD_Value=%d\n", cur_freq, PAMD_Value);
 
     if (PAMD_Value < AF_PAMD_LBound) {
         rds_on = 0;
@@ -648,7 +734,7 @@ int COM_active_af(int fd, RDSData_Struct *rds, int band, uint16_t cur_freq, uint
                 ioctl(fd, FM_IOCTL_TUNE, &parm);
                 usleep(250*1000);
                 ioctl(fd, FM_IOCTL_GETCURPAMD, &PAMD_Level[i]);
-                LOGI("next_freq=%d,PAMD_Level=%d\n", parm.freq, PAMD_Level[i]);
+                FMR_TRACE(TR_AF_CHECK, parm.freq, PAMD_Level[i], 250);
                 if (PAMD_Level[i] > PAMD_Value) {
                     PAMD_Value = PAMD_Level[i];
                     sw_freq = set_freq;
@@ -717,6 +803,7 @@ int COM_is_dese_chan(int fd, int freq)
   */
 int COM_desense_check(int fd, int freq, int rssi)
 {
+    FMR_SPAN("ioctl DESENSE_CHECK", freq);
     int ret = 0;
     fm_desense_check_t parm;
 
@@ -750,6 +837,8 @@ void FM_interface_init(struct fm_cbk_tbl *cbk_tbl)
     cbk_tbl->get_rssi = COM_get_rssi;
     cbk_tbl->get_bler = COM_get_bler;
     cbk_tbl->get_snr  = COM_get_snr;
+    cbk_tbl->get_pamd = COM_get_pamd;
+    cbk_tbl->get_stereo = COM_get_stereo;
     cbk_tbl->get_tune =COM_get_tune;
     cbk_tbl->set_tune =COM_set_tune;
     cbk_tbl->get_audio =COM_get_audio;
@@ -757,6 +846,7 @@ void FM_interface_init(struct fm_cbk_tbl *cbk_tbl)
     cbk_tbl->rw_reg  = COM_rw_reg;
     //For RDS RX.
     cbk_tbl->read_rds_data = COM_read_rds_data;
+    cbk_tbl->wait_rds_event = COM_wait_rds_event;
     cbk_tbl->get_ps = COM_get_ps;
     cbk_tbl->get_rt = COM_get_rt;
     cbk_tbl->active_af = COM_active_af;
@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
 #include "fmr.h"
+#include "SignalMonitor.h"
 #include <cstring>
 
 #ifdef LOG_TAG
@@ -30,6 +32,16 @@
 static int g_idx = -1;
 extern struct fmr_ds fmr_data;
 
+// sampling while tuned, started by the first power up or tune
+static SignalMonitor g_signal([](SignalSample* sample) {
+    return FMR_get_signal(g_idx, &sample->rssi, &sample->snr, &sample->bler) == 0;
+});
+
+SignalMonitor& getSignalMonitor()
+{
+    return g_signal;
+}
+
 bool openDev()
 {
     int ret = 0;
@@ -37,7 +49,7 @@ bool openDev()
       LOGD("%s, device has been opened g_idx=%d,just return",__func__,g_idx);
       return true;
     }
-    if(g_idx = FMR_init() < 0) {
+    if((g_idx = FMR_init()) < 0) {
       LOGD("%s, [FMR_init =%d],open failed \n", __func__, g_idx);
       return false;
     }
@@ -52,6 +64,7 @@ bool closeDev()
 {
     int ret = 0;
 
+    g_signal.stop();
     ret = FMR_close_dev(g_idx);
     g_idx = -1; // should reset to null here
     LOGD("%s, [ret=%d]\n", __func__, ret);
@@ -60,6 +73,7 @@ bool closeDev()
 
 bool powerUp(float freq)
 {
+    FMR_SPAN("bridge powerUp", (int)freq);
     int ret = 0;
     int tmp_freq;
 
@@ -67,6 +81,9 @@ bool powerUp(float freq)
 //    tmp_freq = (int)(freq * 10);        //Eg, 87.5 * 10 --> 875
     tmp_freq = (int)(freq/100);        //Eg,87500 -> 875
     ret = FMR_pwr_up(g_idx, tmp_freq);
+    if (ret == 0) {
+        g_signal.start();
+    }
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
     return ret?RET_FALSE:RET_TRUE;
@@ -79,6 +96,7 @@ bool powerDown(int type)
 {
     int ret = 0;
 
+    g_signal.stop();
     ret = FMR_pwr_down(g_idx, type);
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
@@ -95,12 +113,18 @@ int setStep(int step)
 
 bool tune(float freq)
 {
+    FMR_SPAN("bridge tune", (int)freq);
     int ret = 0;
     int tmp_freq;
 
 //    tmp_freq = (int)(freq * 10);        //Eg, 87.5  --> 875
     tmp_freq = (int)(freq/10);        //Eg, 87500  --> 8750
     ret = FMR_tune(g_idx, tmp_freq);
+    g_signal.invalidate();
+    // the session tunes without powering up first
+    if (ret == 0) {
+        g_signal.start();
+    }
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
     return ret?RET_FALSE:RET_TRUE;
@@ -108,6 +132,7 @@ bool tune(float freq)
 
 float seek(float freq, bool isUp, int spacing)
 {
+    FMR_SPAN("bridge seek", (int)freq);
     int ret = 0;
     int tmp_freq;
     int ret_freq;
@@ -123,7 +148,9 @@ float seek(float freq, bool isUp, int spacing)
     }
     LOGD("%s, [mute] [ret=%d]\n", __func__, ret);
 
+    g_signal.pause();
     ret = FMR_seek(g_idx, tmp_freq, (int)isUp, &ret_freq, spacing);
+    g_signal.resume();
     if (ret) {
         ret_freq = tmp_freq; //seek error, so use original freq
     }
@@ -144,6 +171,16 @@ float seek(float freq, bool isUp, int spacing)
 
 int* autoScan(int* listNum, int spacing)
 {
+    return autoScanRange(listNum, spacing, 0, 0);
+}
+
+/*
+ * scan [lowFreq, highFreq] only, in kHz like the other bridge calls,
+ * 0 means the band edge.
+ */
+int* autoScanRange(int* listNum, int spacing, int lowFreq, int highFreq)
+{
+    FMR_SPAN("bridge autoScanRange", lowFreq);
 
 #define FM_SCAN_CH_SIZE_MAX 200
     int ret = 0;
@@ -153,8 +190,9 @@ int* autoScan(int* listNum, int spacing)
     spacing = spacing/10;
 
     LOGI("%s, [tbl=%p]\n", __func__, ScanTBL);
+    g_signal.pause();
     FMR_Pre_Search(g_idx);
-    ret = FMR_scan(g_idx, ScanTBL, &chl_cnt, 0/*startFreq*/, spacing);
+    ret = FMR_scan_range(g_idx, ScanTBL, &chl_cnt, lowFreq/10, highFreq/10, spacing);
     if (ret < 0) {
         LOGE("scan failed!\n");
         scanChlarray = NULL;
@@ -179,11 +217,31 @@ int* autoScan(int* listNum, int spacing)
     }
 
 out:
+    g_signal.resume();
     LOGD("%s, [cnt=%d] [ret=%d]\n", __func__, chl_cnt, ret);
     return scanChlarray;
 
 }
 
+/*
+ * Parse fm.conf for the HAL configuration, fake channels are left out.
+ * @Result: false - no fm.conf, cfg keeps its values.
+ */
+bool readConfig(struct CUST_cfg_ds* cfg)
+{
+    cfg->fake_chan = NULL;
+    return FMR_parse_cfgs(FMR_CONFIG_FILE, cfg) == 1;
+}
+
+/*
+ * Re-read seek/scan thresholds of fm.conf and its override, for the next seek/scan.
+ * @Result: false - invalid values, the current ones are kept.
+ */
+bool reloadTunables()
+{
+    return FMR_reload_tunables() == 0;
+}
+
 short readRds()
 {
     int ret = 0;
@@ -199,6 +257,33 @@ short readRds()
     return status;
 }
 
+/*
+ * Read rds events and hand back the driver rds block they refer to.
+ * The block is owned by fmr core and is overwritten by the next read.
+ */
+const RDSData_Struct* readRdsData(uint16_t* events)
+{
+    FMR_SPAN("bridge readRdsData");
+    int ret = 0;
+    uint16_t status = 0;
+
+    ret = FMR_read_rds_data(g_idx, &status);
+    if (ret) {
+        status = 0; //there's no event or some error happened
+    }
+    *events = status;
+    return &fmr_data.rds;
+}
+
+/*
+ * Sleep until rds data is ready to be read, instead of polling readRdsData.
+ * @Result: 1 ready, 0 timed out, <0 the driver can't wait (fall back to polling).
+ */
+int waitRdsEvent(int timeoutMs)
+{
+    return FMR_wait_rds_event(g_idx, timeoutMs);
+}
+
 /*
  * attention for result values
  * TODO - why ps also show incorrect data,with obsolete code?
@@ -225,15 +310,13 @@ char* getPs()
 
 int getBler()
 {
-    int ret = 0;
-    int bler = -1;
+    SignalSample sample;
 
-    ret = FMR_get_bler(g_idx, &bler);
-    if (ret) {
-        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
     }
-    LOGD("%s, [bler=%d] [ret=%d]\n", __func__, bler, ret);
-    return bler;
+    return sample.bler;
 }
 
 //TODO - why LastRadioText also show incorrect data,with obsolete code?
@@ -263,7 +346,10 @@ short activeAf()
     int ret = 0;
     short ret_freq = 0;
 
+    // the driver checks and may switch to another channel
+    g_signal.pause();
     ret = FMR_active_af(g_idx, (uint16_t*)&ret_freq);
+    g_signal.resume();
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
         return 0;
@@ -395,14 +481,69 @@ out:
 }
 
 int getRssi()
+{
+    SignalSample sample;
+
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
+    }
+    return sample.rssi;
+}
+
+/*
+ * PAMD (multipath level) of current channel, higher is better.
+ * Return -1 on error.
+ */
+int getPamd()
+{
+    int ret = 0;
+    int pamd = -1;
+
+    ret = FMR_get_pamd(g_idx, &pamd);
+    if (ret) {
+        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    }
+    LOGD("%s, [pamd=%d] [ret=%d]\n", __func__, pamd, ret);
+    return pamd;
+}
+
+int getSnr()
+{
+    SignalSample sample;
+
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
+    }
+    return sample.snr;
+}
+
+/*
+ * Return 1 for stereo, 0 for mono, -1 on error.
+ */
+int getStereo()
 {
     int ret = 0;
-    int rssi = -1;
+    int stereo = -1;
 
-    ret = FMR_get_rssi(g_idx, &rssi);
-    if (ret == -1) {
+    ret = FMR_get_stereo(g_idx, &stereo);
+    if (ret) {
+        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    }
+    LOGD("%s, [stereo=%d] [ret=%d]\n", __func__, stereo, ret);
+    return stereo;
+}
+
+int getChipId()
+{
+    int ret = 0;
+    int chipid = -1;
+
+    ret = FMR_get_chip_id(g_idx, &chipid);
+    if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
     }
-    LOGD("%s, [rssi=%d] [ret=%d]\n", __func__, rssi, ret);
-    return rssi;
+    LOGD("%s, [chipid=%x] [ret=%d]\n", __func__, chipid, ret);
+    return chipid;
 }
@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <termios.h>
 #include <pthread.h>
@@ -32,6 +33,8 @@
 #include <errno.h>
 #include <dlfcn.h>
 
+#include <memory>
+
 #include "fm.h"
 
 #undef FM_LIB_USE_XLOG
@@ -61,8 +64,49 @@
 #define LOGE(...) ALOGE(__VA_ARGS__)
 #endif
 
+/*
+ * Compile-time log level of a module: a .cpp defines FMR_LOG_LEVEL before including
+ * fmr.h, LOGx calls below it compile to nothing (arguments are still type checked).
+ * Per-step detail of the hot paths goes to FMR_TRACE instead, see fmr_trace.h.
+ */
+#define FMR_LOG_LEVEL_VERBOSE 2
+#define FMR_LOG_LEVEL_DEBUG 3
+#define FMR_LOG_LEVEL_INFO 4
+#define FMR_LOG_LEVEL_WARN 5
+#define FMR_LOG_LEVEL_ERROR 6
+#ifndef FMR_LOG_LEVEL
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
+#endif
+#define FMR_LOG_OFF(...) do { if (0) ALOGD(__VA_ARGS__); } while (0)
+#if FMR_LOG_LEVEL > FMR_LOG_LEVEL_VERBOSE
+#undef LOGV
+#define LOGV(...) FMR_LOG_OFF(__VA_ARGS__)
+#endif
+#if FMR_LOG_LEVEL > FMR_LOG_LEVEL_DEBUG
+#undef LOGD
+#define LOGD(...) FMR_LOG_OFF(__VA_ARGS__)
+#endif
+#if FMR_LOG_LEVEL > FMR_LOG_LEVEL_INFO
+#undef LOGI
+#define LOGI(...) FMR_LOG_OFF(__VA_ARGS__)
+#endif
+#if FMR_LOG_LEVEL > FMR_LOG_LEVEL_WARN
+#undef LOGW
+#define LOGW(...) FMR_LOG_OFF(__VA_ARGS__)
+#endif
+
+#include "fmr_trace.h"
+
 #define CUST_LIB_NAME "libfmcust.so"
 #define FM_DEV_NAME "/dev/fm"
+#define FMR_CONFIG_FILE "/vendor/etc/fm.conf"
+#define FMR_MAX_FAKE_CHN_NUM 50
+/* tunable thresholds, may be changed at runtime here */
+#define FMR_CONFIG_OVERRIDE_FILE "/data/vendor/fmradio/fm.conf"
+#define FMR_SEEK_LEV_MIN 0
+#define FMR_SEEK_LEV_MAX 127
+#define FMR_RSSI_TH_MIN (-130)
+#define FMR_RSSI_TH_MAX 0
 
 #define FM_RDS_PS_LEN 8
 
@@ -94,6 +138,15 @@ struct CUST_cfg_ds
     struct fm_fake_channel_t *fake_chan;
 };
 
+/* seek/scan thresholds of fm.conf that can be reloaded, immutable once published */
+struct fmr_tunables
+{
+    int32_t seek_lev = 0;
+    int32_t rssi_th_l2 = FMR_RSSI_TH_MIN;
+    int fake_num = 0;
+    struct fm_fake_channel fake[FMR_MAX_FAKE_CHN_NUM] = {};
+};
+
 struct fm_cbk_tbl {
     //Basic functions.
     int (*open_dev)(const char *pname, int *fd);
@@ -112,6 +165,8 @@ struct fm_cbk_tbl {
     int (*get_rssi)(int fd, int *rssi);
     int (*get_bler)(int fd, int *bler);
     int (*get_snr)(int fd, int *snr);
+    int (*get_pamd)(int fd, int *pamd);
+    int (*get_stereo)(int fd, int *stereo);
     int (*get_tune)(int fd, fm_seek_criteria_parm *parm);
     int (*set_tune)(int fd, fm_seek_criteria_parm *parm);
     int (*get_audio)(int fd, fm_audio_threshold_parm *parm);
@@ -119,6 +174,7 @@ struct fm_cbk_tbl {
     int (*rw_reg)(int fd, fm_reg_ctl_parm *para);
     //FOR RDS RX.
     int (*read_rds_data)(int fd, RDSData_Struct *rds, uint16_t *rds_status);
+    int (*wait_rds_event)(int fd, int timeout_ms);
     int (*get_ps)(int fd, RDSData_Struct *rds, uint8_t **ps, int *ps_len);
     int (*get_rt)(int fd, RDSData_Struct *rds, uint8_t **rt, int *rt_len);
     int (*active_af)(int fd, RDSData_Struct *rds, int band, uint16_t cur_freq, uint16_t *ret_freq);
@@ -192,7 +248,11 @@ void FMR_seterr(int err);
 
 //fmr_core.cpp
 int FMR_init(void);
+int FMR_init_ex(init_func_type init_func);
+int FMR_parse_cfgs(const char *path, struct CUST_cfg_ds *cfg);
 int FMR_get_cfgs(int idx);
+int FMR_reload_tunables(void);
+std::shared_ptr<const struct fmr_tunables> FMR_get_tunables(void);
 int FMR_open_dev(int idx);
 int FMR_close_dev(int idx);
 int FMR_pwr_up(int idx, int freq);
@@ -200,6 +260,11 @@ int FMR_pwr_down(int idx, int type);
 int FMR_set_step(int idx, int step);
 int FMR_seek(int idx, int start_freq, int dir, int *ret_freq, int spacing);
 int FMR_scan(int idx, int *tbl, int *num, int startFreq, int spacing);
+int FMR_scan_range(int idx, int *tbl, int *num, int startFreq, int endFreq, int spacing);
+/* called per station FMR_scan_stream finds, in scan order; non-zero stops the scan */
+typedef int (*fmr_scan_cbk)(void *cookie, int freq, int rssi);
+int FMR_scan_stream(int idx, int startFreq, int endFreq, int spacing,
+                    fmr_scan_cbk cbk, void *cookie, int *num);
 int FMR_stop_scan(int idx);
 int FMR_tune(int idx, int freq);
 int FMR_set_mute(int idx, int mute);
@@ -207,12 +272,16 @@ int FMR_is_rdsrx_support(int idx, int *supt);
 int FMR_turn_on_off_rds(int idx, int onoff);
 int FMR_get_chip_id(int idx, int *chipid);
 int FMR_read_rds_data(int idx, uint16_t *rds_status);
+int FMR_wait_rds_event(int idx, int timeout_ms);
 int FMR_get_ps(int idx, uint8_t **ps, int *ps_len);
 int FMR_get_rssi(int idx, int *rssi);
 int FMR_get_rt(int idx, uint8_t **rt, int *rt_len);
 int FMR_get_bler(int idx, int *bler);
 int FMR_active_af(int idx, uint16_t *ret_freq);
 int FMR_get_snr(int idx, int *snr);
+int FMR_get_pamd(int idx, int *pamd);
+int FMR_get_signal(int idx, int *rssi, int *snr, int *bler);
+int FMR_get_stereo(int idx, int *stereo);
 int FMR_get_tune(int idx,fm_seek_criteria_parm *parm);
 int FMR_set_tune(int idx,fm_seek_criteria_parm *parm);
 int FMR_get_audio(int idx,fm_audio_threshold_parm *parm);
@@ -220,6 +289,7 @@ int FMR_set_audio(int idx,fm_audio_threshold_parm *parm);
 int FMR_rw_reg(int idx, fm_reg_ctl_parm *fcp);
 
 int FMR_ana_switch(int idx, int antenna);
+fm_bool FMR_SevereDensense(const struct fmr_tunables *tun, fm_u16 ChannelNo, fm_s32 RSSI);
 int FMR_Pre_Search(int idx);
 int FMR_Restore_Search(int idx);
 
@@ -240,12 +310,15 @@ int COM_turn_on_off_rds(int fd, int onoff);
 int COM_get_chip_id(int fd, int *chipid);
 int COM_get_rssi(int fd, int *rssi);
 int COM_get_snr(int fd, int *snr);
+int COM_get_pamd(int fd, int *pamd);
+int COM_get_stereo(int fd, int *stereo);
 int COM_get_tune(int idx,fm_seek_criteria_parm *parm);
 int COM_set_tune(int idx,fm_seek_criteria_parm *parm);
 int COM_get_audio(int idx,fm_audio_threshold_parm *parm);
 int COM_set_audio(int idx,fm_audio_threshold_parm *parm);
 int COM_rw_reg(int fd, fm_reg_ctl_parm *para);
 int COM_read_rds_data(int fd, RDSData_Struct *rds, uint16_t *rds_status);
+int COM_wait_rds_event(int fd, int timeout_ms);
 int COM_get_ps(int fd, RDSData_Struct *rds, uint8_t **ps, int *ps_len);
 int COM_get_rt(int fd, RDSData_Struct *rds, uint8_t **rt, int *rt_len);
 int COM_active_af(int fd, RDSData_Struct *rds, int band, uint16_t cur_freq, uint16_t *ret_freq);
@@ -265,7 +338,12 @@ int setStep(int step);
 bool tune(float freq);
 float seek(float freq, bool isUp, int spacing); //jboolean isUp;
 int* autoScan(int* listNum, int spacing);
+int* autoScanRange(int* listNum, int spacing, int lowFreq, int highFreq);
+bool readConfig(struct CUST_cfg_ds* cfg);
+bool reloadTunables();
 short readRds();
+const RDSData_Struct* readRdsData(uint16_t* events);
+int waitRdsEvent(int timeoutMs);
 char* getPs();
 int getBler();
 char* getLrText();
@@ -277,6 +355,12 @@ int setMute(bool mute);
 int isRdsSupport();
 int switchAntenna(int antenna);
 int getRssi();
+int getPamd();
+int getSnr();
+int getStereo();
+int getChipId();
+class SignalMonitor;
+SignalMonitor& getSignalMonitor();
 
 #define FMR_ASSERT(a) { \
     if ((a) == NULL) { \
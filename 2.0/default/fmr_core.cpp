@@ -28,6 +28,7 @@
  *
  *******************************************************************/
 
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
 #include "fmr.h"
 #include <stdio.h>
 #include <stdlib.h>  
@@ -40,15 +41,15 @@
 #undef LOG_TAG
 #endif
 #define LOG_TAG "FMHAL_CORE"
-#define FMR_CONFIG_FILE "/vendor/etc/fm.conf"
 
 #define FMR_MAX_IDX 1
-#define FMR_MAX_FAKE_CHN_NUM 50
 
 struct fmr_ds fmr_data;
 struct fmr_ds *pfmr_data[FMR_MAX_IDX] = {0};
 struct fm_fake_channel gFmFakeChnList[FMR_MAX_FAKE_CHN_NUM];
 struct fm_fake_channel_t gFakeChn;
+/* seek/scan thresholds, replaced as a whole on reload; std::atomic_load/atomic_store only */
+static std::shared_ptr<const struct fmr_tunables> g_tunables;
 
 #define FMR_fd(idx) ((pfmr_data[idx])->fd)
 #define FMR_err(idx) ((pfmr_data[idx])->err)
@@ -71,90 +72,203 @@ struct fm_fake_channel_t gFakeChn;
 
 static void killer(int sig) ;
 	
-int FMR_get_cfgs(int idx)
-{   
+/* trims blanks and line ends of both sides, in place */
+static char *FMR_trim(char *str)
+{
+    size_t len;
+
+    while (*str == ' ' || *str == '\t') str++;
+    len = strlen(str);
+    while (len > 0 && (str[len - 1] == ' ' || str[len - 1] == '\t' ||
+                       str[len - 1] == '\r' || str[len - 1] == '\n')) {
+        str[--len] = '\0';
+    }
+    return str;
+}
+
+/*  FMR_parse_cfgs -- parse a fm.conf style file
+  *  @path - file to parse
+  *  @cfg - values found are written here, the others are left alone;
+  *         fake channels go to cfg->fake_chan when it's set, at most FMR_MAX_FAKE_CHN_NUM
+  *  return value: 1, parsed; 0, no such file.
+  */
+int FMR_parse_cfgs(const char *path, struct CUST_cfg_ds *cfg)
+{
     FILE *fp;
     int mFakeCounter = 0;
-    char curLine[1024];  
-    char *ret;
-    char *valueStr;  
+    char curLine[1024];
+    char *key;
+    char *valueStr;
 
-    memset(gFmFakeChnList, 0, sizeof (struct fm_fake_channel) * FMR_MAX_FAKE_CHN_NUM);
-    FMR_fake_chan(idx) = &gFakeChn;
-    gFakeChn.chan = gFmFakeChnList;
-    LOGE("open file:%s \n", FMR_CONFIG_FILE);
-    if((fp = fopen(FMR_CONFIG_FILE, "r")) == NULL)
-    {   
-        LOGE("open file:%s fail\n", FMR_CONFIG_FILE);
+    FMR_ASSERT(path);
+    FMR_ASSERT(cfg);
+
+    LOGI("open file:%s \n", path);
+    if((fp = fopen(path, "r")) == NULL)
+    {
+        LOGE("open file:%s fail\n", path);
         return 0;
     }
-    while(!feof(fp))
+    while (fgets(curLine, sizeof(curLine), fp) != NULL)
     {
-        curLine[0] = '\0';
-        ret = fgets(curLine, 1024, fp);
-        if(ret == NULL) {
-            break;
-        }
         LOGD("get line:%s \n", curLine);
 
         /* remove the comments */
         valueStr= strchr(curLine, '#');
         if (NULL != valueStr){
             valueStr[0] = '\0';
-        } 
+        }
 
         valueStr= strchr(curLine, '=');
-        if (NULL != valueStr){
-            valueStr[0] = '\0';
-            valueStr = &valueStr[1];
+        if (NULL == valueStr){
+            continue;
         }
-        else  {
-             continue;
-         }
-
-        while (valueStr[0] == ' ' || valueStr[0] == '\t') valueStr++;
-        while (valueStr[strlen(valueStr) - 1] == ' ' || valueStr[strlen(valueStr) - 1] == '\t') valueStr[strlen(valueStr) - 1] = '\0';
-        while (curLine[strlen(curLine) - 1] == ' ' || curLine[strlen(curLine) - 1] == '\t') curLine[strlen(curLine) - 1] = '\0';
-
-        LOGD("title:%s,  value:%s\n", curLine, valueStr);
-
-        if (!strcmp(curLine, "chip"))  FMR_chip(idx) = atoi(valueStr);
-        if (!strcmp(curLine, "band"))  FMR_band(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "low band"))  FMR_low_band(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "high band"))   FMR_high_band(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "seek space"))  FMR_seek_space(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "max scan num"))  FMR_max_scan_num(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "seek level"))  FMR_seek_lev(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "scan sort"))  FMR_scan_sort(idx) = atoi(valueStr);
-        if (!strcmp(curLine, "short antenna support"))  FMR_short_ana_sup(idx)  = atoi(valueStr);
-        if (!strcmp(curLine, "rssi threshold"))  FMR_rssi_th_l2(idx)  = atoi(valueStr);
-
-        if (!strcmp(curLine, "fake channel")) {
-            sscanf(valueStr, "%d;%d;%d", &gFmFakeChnList[mFakeCounter].freq, &gFmFakeChnList[mFakeCounter].rssi_th, &gFmFakeChnList[mFakeCounter].reserve);
+        valueStr[0] = '\0';
+        key = FMR_trim(curLine);
+        valueStr = FMR_trim(&valueStr[1]);
+
+        LOGD("title:%s,  value:%s\n", key, valueStr);
+
+        if (!strcmp(key, "chip"))  cfg->chip = atoi(valueStr);
+        if (!strcmp(key, "band"))  cfg->band  = atoi(valueStr);
+        if (!strcmp(key, "low band"))  cfg->low_band  = atoi(valueStr);
+        if (!strcmp(key, "high band"))   cfg->high_band  = atoi(valueStr);
+        if (!strcmp(key, "seek space"))  cfg->seek_space  = atoi(valueStr);
+        if (!strcmp(key, "max scan num"))  cfg->max_scan_num  = atoi(valueStr);
+        if (!strcmp(key, "seek level"))  cfg->seek_lev  = atoi(valueStr);
+        if (!strcmp(key, "scan sort"))  cfg->scan_sort = atoi(valueStr);
+        if (!strcmp(key, "short antenna support"))  cfg->short_ana_sup  = atoi(valueStr);
+        if (!strcmp(key, "rssi threshold"))  cfg->rssi_th_l2  = atoi(valueStr);
+
+        if (!strcmp(key, "fake channel") && cfg->fake_chan != NULL) {
+            if (mFakeCounter >= FMR_MAX_FAKE_CHN_NUM) {
+                LOGW("too many fake channels, %s ignored\n", valueStr);
+                continue;
+            }
+            struct fm_fake_channel *chan = &cfg->fake_chan->chan[mFakeCounter];
+            sscanf(valueStr, "%d;%d;%d", &chan->freq, &chan->rssi_th, &chan->reserve);
             mFakeCounter++;
         }
-
     }
-    gFakeChn.size = mFakeCounter;
+    if (cfg->fake_chan != NULL) {
+        cfg->fake_chan->size = mFakeCounter;
+    }
 
     LOGD("chip: %d, band: %d, low_band: %d, high_band: %d, seek_space: %d, max_scan_num: %d, seek_lev: %d, scan_sort: %d, short_ana_sup: %d, rssi_th_l2: %d, mFakeCounter:%d ",  \
-		pfmr_data[idx]->cfg_data.chip,  \
-		pfmr_data[idx]->cfg_data.band,  \
-		pfmr_data[idx]->cfg_data.low_band, \
-		pfmr_data[idx]->cfg_data.high_band, \
-		pfmr_data[idx]->cfg_data.seek_space, \
-		pfmr_data[idx]->cfg_data.max_scan_num, \
-		pfmr_data[idx]->cfg_data.seek_lev, \
-		pfmr_data[idx]->cfg_data.scan_sort, \
-		pfmr_data[idx]->cfg_data.short_ana_sup, \
-		pfmr_data[idx]->cfg_data.rssi_th_l2, \
+		cfg->chip,  \
+		cfg->band,  \
+		cfg->low_band, \
+		cfg->high_band, \
+		cfg->seek_space, \
+		cfg->max_scan_num, \
+		cfg->seek_lev, \
+		cfg->scan_sort, \
+		cfg->short_ana_sup, \
+		cfg->rssi_th_l2, \
 		mFakeCounter);
 
     fclose(fp);
     return 1;
 }
 
+/*  FMR_publish_tunables -- validate the thresholds of cfg and make them the current ones
+  *  Seeks and scans in flight keep the snapshot they started with.
+  *  return value: 0, published; else error NO, the current ones are kept.
+  */
+static int FMR_publish_tunables(const struct CUST_cfg_ds *cfg)
+{
+    auto tun = std::make_shared<struct fmr_tunables>();
+
+    if (cfg->seek_lev < FMR_SEEK_LEV_MIN || cfg->seek_lev > FMR_SEEK_LEV_MAX) {
+        LOGE("%s, invalid seek level %d\n", __func__, cfg->seek_lev);
+        return -ERR_INVALID_PARA;
+    }
+    if (cfg->rssi_th_l2 < FMR_RSSI_TH_MIN || cfg->rssi_th_l2 > FMR_RSSI_TH_MAX) {
+        LOGE("%s, invalid rssi threshold %d\n", __func__, cfg->rssi_th_l2);
+        return -ERR_INVALID_PARA;
+    }
+    tun->seek_lev = cfg->seek_lev;
+    tun->rssi_th_l2 = cfg->rssi_th_l2;
+    if (cfg->fake_chan != NULL) {
+        for (int i = 0; i < cfg->fake_chan->size; i++) {
+            const struct fm_fake_channel *chan = &cfg->fake_chan->chan[i];
+            if (chan->freq <= 0 || chan->rssi_th < FMR_RSSI_TH_MIN || chan->rssi_th > FMR_RSSI_TH_MAX) {
+                LOGE("%s, invalid fake channel %d;%d\n", __func__, chan->freq, chan->rssi_th);
+                return -ERR_INVALID_PARA;
+            }
+            tun->fake[tun->fake_num++] = *chan;
+        }
+    }
+
+    std::atomic_store(&g_tunables, std::shared_ptr<const struct fmr_tunables>(std::move(tun)));
+    LOGI("%s, [seek_lev=%d] [rssi_th=%d] [fake=%d]\n", __func__, cfg->seek_lev,
+         cfg->rssi_th_l2, cfg->fake_chan != NULL ? cfg->fake_chan->size : 0);
+    return 0;
+}
+
+/*  FMR_reload_tunables -- re-read the seek/scan thresholds
+  *  fm.conf, then the values of FMR_CONFIG_OVERRIDE_FILE on top, when there is one.
+  *  Other settings (band, chip...) are only read by FMR_init.
+  *  return value: 0, published; else error NO, the current ones are kept.
+  */
+int FMR_reload_tunables(void)
+{
+    struct CUST_cfg_ds cfg;
+    struct fm_fake_channel chans[FMR_MAX_FAKE_CHN_NUM];
+    struct fm_fake_channel_t fake;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.rssi_th_l2 = FMR_RSSI_TH_MIN; // no "rssi threshold", no station dropped for it
+    memset(chans, 0, sizeof(chans));
+    fake.size = 0;
+    fake.chan = chans;
+    cfg.fake_chan = &fake;
+
+    FMR_parse_cfgs(FMR_CONFIG_FILE, &cfg);
+    // an override listing no fake channel leaves those of fm.conf
+    int base_fake = fake.size;
+    FMR_parse_cfgs(FMR_CONFIG_OVERRIDE_FILE, &cfg);
+    if (fake.size == 0) fake.size = base_fake;
+
+    return FMR_publish_tunables(&cfg);
+}
+
+std::shared_ptr<const struct fmr_tunables> FMR_get_tunables(void)
+{
+    static const std::shared_ptr<const struct fmr_tunables> defaults =
+        std::make_shared<const struct fmr_tunables>();
+    auto tun = std::atomic_load(&g_tunables);
+    return tun != NULL ? tun : defaults;
+}
+
+int FMR_get_cfgs(int idx)
+{
+    int ret = 0;
+
+    memset(gFmFakeChnList, 0, sizeof (struct fm_fake_channel) * FMR_MAX_FAKE_CHN_NUM);
+    FMR_fake_chan(idx) = &gFakeChn;
+    gFakeChn.chan = gFmFakeChnList;
+    gFakeChn.size = 0;
+
+    ret = FMR_parse_cfgs(FMR_CONFIG_FILE, &pfmr_data[idx]->cfg_data);
+    if (FMR_reload_tunables() < 0) {
+        LOGW("%s, bad %s, using %s only\n", __func__, FMR_CONFIG_OVERRIDE_FILE, FMR_CONFIG_FILE);
+        FMR_publish_tunables(&pfmr_data[idx]->cfg_data);
+    }
+    return ret;
+}
+
 int FMR_init()
+{
+    return FMR_init_ex(FM_interface_init);
+}
+
+/*  FMR_init_ex -- FMR_init with another callback table
+  *  @init_func - fills the table every FMR_* call goes through, Eg. a simulated chip
+  *               for benchmarks; FMR_init uses FM_interface_init, the /dev/fm one.
+  *  return value: idx, else -1.
+  */
+int FMR_init_ex(init_func_type init_func)
 {
     int idx = 0;
     int ret = 0;
@@ -172,13 +286,14 @@ int FMR_init()
     I do not know where to release it, so use static global param instead*/
     pfmr_data[idx] = &fmr_data;
     memset(pfmr_data[idx], 0, sizeof(struct fmr_ds));
+    pfmr_data[idx]->cfg_data.rssi_th_l2 = FMR_RSSI_TH_MIN;
 
     if (FMR_get_cfgs(idx) < 0) {
         LOGI("FMR_get_cfgs failed\n");
         goto fail;
     }
 
-    pfmr_data[idx]->init_func = FM_interface_init;
+    pfmr_data[idx]->init_func = init_func;
     if (pfmr_data[idx]->init_func == NULL) {
         LOGE("%s init_func error, %s\n", __func__, dlerror());
         goto fail;
@@ -226,6 +341,7 @@ int FMR_close_dev(int idx)
 
 int FMR_pwr_up(int idx, int freq)
 {
+    FMR_SPAN("FMR_pwr_up", freq);
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).pwr_up);
@@ -312,6 +428,52 @@ int FMR_get_snr(int idx, int *snr)
     return ret;
 }
 
+/*
+ * One signal quality sample of the tuned channel, the sampler of the SignalMonitor
+ * of both the HAL and the jni.
+ * @Result: result of the rssi read; snr/bler are -1 when their read failed.
+ */
+int FMR_get_signal(int idx, int *rssi, int *snr, int *bler)
+{
+    int ret = FMR_get_rssi(idx, rssi);
+
+    FMR_get_snr(idx, snr);
+    FMR_get_bler(idx, bler);
+    return ret;
+}
+
+int FMR_get_pamd(int idx, int *pamd)
+{
+    int ret = 0;
+
+    FMR_ASSERT(FMR_cbk_tbl(idx).get_pamd);
+    FMR_ASSERT(pamd);
+
+    ret = FMR_cbk_tbl(idx).get_pamd(FMR_fd(idx), pamd);
+    if (ret) {
+        LOGE("%s failed, %s\n", __func__, FMR_strerr());
+        *pamd = -1;
+    }
+    LOGD("%s, [ret=%d]\n", __func__, ret);
+    return ret;
+}
+
+int FMR_get_stereo(int idx, int *stereo)
+{
+    int ret = 0;
+
+    FMR_ASSERT(FMR_cbk_tbl(idx).get_stereo);
+    FMR_ASSERT(stereo);
+
+    ret = FMR_cbk_tbl(idx).get_stereo(FMR_fd(idx), stereo);
+    if (ret) {
+        LOGE("%s failed, %s\n", __func__, FMR_strerr());
+        *stereo = -1;
+    }
+    LOGD("%s, [ret=%d]\n", __func__, ret);
+    return ret;
+}
+
 int FMR_get_tune(int idx, fm_seek_criteria_parm *parm)
 {
     int ret = 0;
@@ -430,6 +592,7 @@ int FMR_get_bler(int idx, int *bler)
 
 int FMR_tune(int idx, int freq)
 {
+    FMR_SPAN("FMR_tune", freq);
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).tune);
@@ -439,7 +602,7 @@ int FMR_tune(int idx, int freq)
         LOGE("%s failed, [ret=%d]\n", __func__, ret);
     }
     fmr_data.cur_freq = freq;
-    LOGD("%s, [freq=%d] [ret=%d]\n", __func__, freq, ret);
+    FMR_TRACE(TR_TUNE, freq, ret);
     return ret;
 }
 
@@ -455,19 +618,15 @@ fm_bool FMR_DensenseDetect(fm_s32 idx, fm_u16 ChannelNo, fm_s32 RSSI)
     return fm_false;
 }
 
-fm_bool FMR_SevereDensense(fm_u16 ChannelNo, fm_s32 RSSI)
+fm_bool FMR_SevereDensense(const struct fmr_tunables *tun, fm_u16 ChannelNo, fm_s32 RSSI)
 {
     fm_s32 i = 0;
-    struct fm_fake_channel_t *chan_info = fmr_data.cfg_data.fake_chan;
 
     //ChannelNo /= 10;
-     LOGI(" SevereDensense[%d] RSSI[%d]\n", ChannelNo,RSSI);
-
-    for (i=0; i<chan_info->size; i++) {
-        if (ChannelNo == chan_info->chan[i].freq) {
+    for (i=0; i<tun->fake_num; i++) {
+        if (ChannelNo == tun->fake[i].freq) {
             //if (RSSI < FM_SEVERE_RSSI_TH)
-            if (RSSI < chan_info->chan[i].rssi_th) {
-                LOGI(" SevereDensense[%d] RSSI[%d]\n", ChannelNo,RSSI);
+            if (RSSI < tun->fake[i].rssi_th) {
                 return fm_true;
             } else {
                 break;
@@ -501,7 +660,7 @@ fm_bool FMR_NoiseFloorDetect(fm_bool *rF, fm_s32 rssi, fm_s32 *F_rssi)
 return fm_true : need check cur_freq->valid
          fm_false: check faild, should stop seek
 */
-static fm_bool FMR_Seek_TuneCheck(int idx, fm_softmute_tune_t *cur_freq)
+static fm_bool FMR_Seek_TuneCheck(int idx, const struct fmr_tunables *tun, fm_softmute_tune_t *cur_freq)
 {
     int ret = 0;
     if (fmr_data.scan_stop == fm_true) {
@@ -516,24 +675,27 @@ static fm_bool FMR_Seek_TuneCheck(int idx, fm_softmute_tune_t *cur_freq)
         return fm_true;
     }
     if (cur_freq->valid == fm_true)/*get valid channel*/ {
+        if (cur_freq->rssi < tun->rssi_th_l2) {
+            cur_freq->valid = fm_false;
+            return fm_true;
+        }
         if (FMR_DensenseDetect(idx, cur_freq->freq, cur_freq->rssi) == fm_true) {
-            LOGI("desense channel detected:[%d] \n", cur_freq->freq);
+            FMR_TRACE(TR_SCAN_DESENSE, cur_freq->freq, cur_freq->rssi, 0);
             cur_freq->valid = fm_false;
             return fm_true;
         }
-        if (FMR_SevereDensense(cur_freq->freq, cur_freq->rssi) == fm_true) {
-            LOGI("sever desense channel detected:[%d] \n", cur_freq->freq);
+        if (FMR_SevereDensense(tun, cur_freq->freq, cur_freq->rssi) == fm_true) {
+            FMR_TRACE(TR_SCAN_DESENSE, cur_freq->freq, cur_freq->rssi, 1);
             cur_freq->valid = fm_false;
             return fm_true;
         }
-        LOGI("seek result freq:[%d] \n", cur_freq->freq);
     }
     return fm_true;
 }
 /*
 check more 2 freq, curfreq: current freq, seek_dir: 1,forward. 0,backword
 */
-static int FMR_Seek_More(int idx, fm_softmute_tune_t *validfreq, fm_u8 seek_dir, fm_u8 step, fm_u16 min_freq, fm_u16 max_freq)
+static int FMR_Seek_More(int idx, const struct fmr_tunables *tun, fm_softmute_tune_t *validfreq, fm_u8 seek_dir, fm_u8 step, fm_u16 min_freq, fm_u16 max_freq)
 {
     fm_s32 i;
     fm_softmute_tune_t cur_freq;
@@ -551,12 +713,11 @@ static int FMR_Seek_More(int idx, fm_softmute_tune_t *validfreq, fm_u8 seek_dir,
             }
             cur_freq.freq -= step;
         }
-        if (FMR_Seek_TuneCheck(idx, &cur_freq) == fm_true) {
+        if (FMR_Seek_TuneCheck(idx, tun, &cur_freq) == fm_true) {
             if (cur_freq.valid == fm_true) {
                 if (cur_freq.rssi > validfreq->rssi) {
                     validfreq->freq = cur_freq.freq;
                     validfreq->rssi = cur_freq.rssi;
-                    LOGI("seek cover last by freq=%d",cur_freq.freq);
                 }
             }
         } else {
@@ -574,19 +735,20 @@ int FMR_seek_Channel(int idx, int start_freq, int min_freq, int max_freq, int ba
 {
     fm_s32 i, ret = 0;
     fm_softmute_tune_t cur_freq;
+    auto tunables = FMR_get_tunables(); // the whole seek on one snapshot
+    const struct fmr_tunables *tun = tunables.get();
 
     if (dir == 1)/*forward*/ {
         for (i=((start_freq-min_freq)/seek_space+1); i<band_channel_no; i++) {
             cur_freq.freq = min_freq + seek_space*i;
-            LOGI("i=%d, freq=%d-----1",i,cur_freq.freq);
-            ret = FMR_Seek_TuneCheck(idx, &cur_freq);
+            ret = FMR_Seek_TuneCheck(idx, tun, &cur_freq);
             if (ret == fm_false) {
                 return -1;
             } else {
                 if (cur_freq.valid == fm_false) {
                     continue;
                 } else {
-                    if (FMR_Seek_More(idx, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
+                    if (FMR_Seek_More(idx, tun, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
                         *ret_freq = cur_freq.freq;
                         *rssi_tmp = cur_freq.rssi;
                         return 0;
@@ -598,15 +760,14 @@ int FMR_seek_Channel(int idx, int start_freq, int min_freq, int max_freq, int ba
         }
         for (i=0; i<((start_freq-min_freq)/seek_space); i++) {
             cur_freq.freq = min_freq + seek_space*i;
-            LOGI("i=%d, freq=%d-----2",i,cur_freq.freq);
-            ret = FMR_Seek_TuneCheck(idx, &cur_freq);
+            ret = FMR_Seek_TuneCheck(idx, tun, &cur_freq);
             if (ret == fm_false) {
                 return -1;
             } else {
                 if (cur_freq.valid == fm_false) {
                     continue;
                 } else {
-                    if (FMR_Seek_More(idx, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
+                    if (FMR_Seek_More(idx, tun, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
                         *ret_freq = cur_freq.freq;
                         *rssi_tmp = cur_freq.rssi;
                         return 0;
@@ -619,15 +780,14 @@ int FMR_seek_Channel(int idx, int start_freq, int min_freq, int max_freq, int ba
     } else/*backward*/ {
         for (i=((start_freq-min_freq)/seek_space-1); i>=0; i--) {
             cur_freq.freq = min_freq + seek_space*i;
-            LOGI("i=%d, freq=%d-----3",i,cur_freq.freq);
-            ret = FMR_Seek_TuneCheck(idx, &cur_freq);
+            ret = FMR_Seek_TuneCheck(idx, tun, &cur_freq);
             if (ret == fm_false) {
                 return -1;
             } else {
                 if (cur_freq.valid == fm_false) {
                     continue;
                 } else {
-                    if (FMR_Seek_More(idx, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
+                    if (FMR_Seek_More(idx, tun, &cur_freq, dir, seek_space, min_freq, max_freq) == 0) {
                         *ret_freq = cur_freq.freq;
                         *rssi_tmp = cur_freq.rssi;
                         return 0;
@@ -639,15 +799,14 @@ int FMR_seek_Channel(int idx, int start_freq, int min_freq, int max_freq, int ba
         }
         for (i=(band_channel_no-1); i>((start_freq-min_freq)/seek_space); i--) {
             cur_freq.freq = min_freq + seek_space*i;
-            LOGI("i=%d, freq=%d-----4",i,cur_freq.freq);
-            ret = FMR_Seek_TuneCheck(idx, &cur_freq);
+            ret = FMR_Seek_TuneCheck(idx, tun, &cur_freq);
             if (ret == fm_false) {
                 return -1;
             } else {
                 if (cur_freq.valid == fm_false) {
                     continue;
                 } else {
-                    if (FMR_Seek_More(idx, &cur_freq, dir,seek_space, min_freq, max_freq) == 0) {
+                    if (FMR_Seek_More(idx, tun, &cur_freq, dir,seek_space, min_freq, max_freq) == 0) {
                         *ret_freq = cur_freq.freq;
                         *rssi_tmp = cur_freq.rssi;
                         return 0;
@@ -663,8 +822,28 @@ int FMR_seek_Channel(int idx, int start_freq, int min_freq, int max_freq, int ba
     return 0;
 }
 
+/*
+ * Reads the rssi of the channel a hardware seek stopped on and checks it against
+ * "rssi threshold" of fm.conf, which the chip's own seek level doesn't cover.
+ * return fm_true: strong enough, or the rssi can't be read (the chip's verdict stands)
+ */
+static fm_bool FMR_Seek_RssiCheck(int idx, const struct fmr_tunables *tun, fm_s32 *rssi)
+{
+    int tmp = 0;
+
+    if (FMR_cbk_tbl(idx).get_rssi == NULL) {
+        return fm_true;
+    }
+    if (FMR_cbk_tbl(idx).get_rssi(FMR_fd(idx), &tmp) != 0) {
+        return fm_true;
+    }
+    *rssi = tmp;
+    return tmp >= tun->rssi_th_l2 ? fm_true : fm_false;
+}
+
 int FMR_seek(int idx, int start_freq, int dir, int *ret_freq, int spacing)
 {
+    FMR_SPAN("FMR_seek", start_freq);
     fm_s32 ret = 0;
     fm_s32 band_channel_no = 0;
     fm_u8 seek_space = spacing;
@@ -694,28 +873,43 @@ int FMR_seek(int idx, int start_freq, int dir, int *ret_freq, int spacing)
 
     //ret = FMR_seek_Channel(idx, start_freq, min_freq, max_freq, band_channel_no, seek_space, dir, ret_freq, &rssi);
 
-    int tmp_freq = (dir == 1)?  (start_freq + seek_space) : (start_freq - seek_space) ;
-    ret = FMR_cbk_tbl(idx).seek(FMR_fd(idx), &tmp_freq, 0, !dir, 0);
-    LOGE("hardware seek, ret: %d, current freq: %d\n",ret, tmp_freq);
+    auto tunables = FMR_get_tunables(); // the whole seek on one snapshot
+    int tmp_freq = start_freq;
+    fm_s32 rssi = 0;
+    fm_bool found = fm_false;
+    // a station under the rssi threshold is skipped, at most once around the band
+    for (int i = 0; i < band_channel_no; i++) {
+        tmp_freq = (dir == 1)?  (tmp_freq + seek_space) : (tmp_freq - seek_space) ;
+        ret = FMR_cbk_tbl(idx).seek(FMR_fd(idx), &tmp_freq, 0, !dir, tunables->seek_lev);
+        if (ret != 0 || tmp_freq == 0 || tmp_freq == start_freq) break;
+        if (FMR_Seek_RssiCheck(idx, tunables.get(), &rssi) == fm_true) {
+            found = fm_true;
+            break;
+        }
+        FMR_TRACE(TR_SEEK_WEAK, tmp_freq, rssi, tunables->rssi_th_l2);
+    }
+    if (found == fm_false) {
+        tmp_freq = 0; // nothing strong enough, stay where we are
+    }
 
     if (0 == ret) {
         if(tmp_freq != 0){
           *ret_freq = (tmp_freq);
-          LOGE("hardware seek, ret: %d, ret freq: %d\n",ret, *ret_freq);
           // app will tune to freq later, so FMR_tune is not necessary.
           // ret = FMR_tune(idx, tmp_freq);
         }else {
           *ret_freq = start_freq;
-          LOGE("hardware seek channel none, ret: %d, set start_freq: %d as tune value\n",ret, *ret_freq);
           // app will tune to freq later, so FMR_tune is not necessary.
           // ret = FMR_tune(idx, start_freq/10);
         }
     }
+    FMR_TRACE(TR_SEEK_RESULT, start_freq, ret == 0 ? *ret_freq : 0, ret);
     return ret;
 }
 
 int FMR_set_mute(int idx, int mute)
 {
+    FMR_SPAN("FMR_set_mute", mute);
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).set_mute)
@@ -764,17 +958,26 @@ int FMR_Restore_Search(int idx)
     return 0;
 }
 
-int FMR_seek_Channels(int idx, int *scan_tbl, int *max_cnt, fm_s32 band_channel_no, fm_u16 Start_Freq, fm_u8 seek_space, fm_u8 NF_Space)
+/*
+ * scan_tbl may be NULL when cbk takes the stations; otherwise *max_cnt is its capacity
+ * on entry and the station count on return.
+ */
+int FMR_seek_Channels(int idx, int *scan_tbl, int *max_cnt, fm_s32 band_channel_no, fm_u16 Start_Freq, fm_u16 End_Freq, fm_u8 seek_space, fm_u8 NF_Space,
+                      fmr_scan_cbk cbk, void *cookie)
 {
+    FMR_SPAN("FMR_seek_Channels", Start_Freq);
     fm_s32 ret = 0, Num = 0, i=0;
     fm_u32 ChannelNo = 0;
     fm_softmute_tune_t cur_freq;
     static struct fm_cqi SortData[CQI_CH_NUM_MAX];
     fm_u32 LastValidFreq = 0;
+    fm_s32 Limit = (scan_tbl != NULL && *max_cnt < CQI_CH_NUM_MAX) ? *max_cnt : CQI_CH_NUM_MAX;
+    auto tunables = FMR_get_tunables(); // the whole scan on one snapshot
+    const struct fmr_tunables *tun = tunables.get();
 
     memset(SortData, 0, CQI_CH_NUM_MAX*sizeof(struct fm_cqi));
     memset(&cur_freq, 0, sizeof(fm_softmute_tune_t));
-    LOGI("band_channel_no=[%d], seek_space=%d, start freq=%d, NF_Space=%d\n", band_channel_no,seek_space,Start_Freq,NF_Space);
+    LOGI("band_channel_no=[%d], seek_space=%d, start freq=%d, end freq=%d, NF_Space=%d\n", band_channel_no,seek_space,Start_Freq,End_Freq,NF_Space);
 
     cur_freq.freq = Start_Freq - seek_space;
 
@@ -792,43 +995,60 @@ int FMR_seek_Channels(int idx, int *scan_tbl, int *max_cnt, fm_s32 band_channel_
 
         cur_freq.freq += seek_space;
 
-        ret = FMR_cbk_tbl(idx).seek(FMR_fd(idx), (int *)&cur_freq.freq, 0, 0, 0);
-        LOGE("hardware seek, ret: %d, current freq: %d, last freq: %d\n",ret, cur_freq.freq, LastValidFreq);
+        ret = FMR_cbk_tbl(idx).seek(FMR_fd(idx), (int *)&cur_freq.freq, 0, 0, tun->seek_lev);
+        FMR_TRACE(TR_SEEK_STEP, cur_freq.freq, LastValidFreq, ret);
 
         if (0 != ret || LastValidFreq >= cur_freq.freq) {
-            LOGE("hardware scan stop:[%d]\n",ret);
             continue;
         }
 
-        LOGI("FMR_scan_Channels try %d, freq: %d, is valid: %d ", i++, cur_freq.freq, cur_freq.valid);
-		
+        if (cur_freq.freq > End_Freq) {
+            LOGI("scan reached end freq:[%d] \n", End_Freq);
+            break;
+        }
+
+        if (FMR_Seek_RssiCheck(idx, tun, &cur_freq.rssi) == fm_false) {
+            FMR_TRACE(TR_SEEK_WEAK, cur_freq.freq, cur_freq.rssi, tun->rssi_th_l2);
+            continue;
+        }
+
 
         if (FMR_DensenseDetect(idx, cur_freq.freq, cur_freq.rssi) == fm_true) {
-                LOGI("desense channel detected:[%d] \n", cur_freq.freq);
+                FMR_TRACE(TR_SCAN_DESENSE, cur_freq.freq, cur_freq.rssi, 0);
                 continue;
         }
            
-        if (FMR_SevereDensense(cur_freq.freq, cur_freq.rssi) == fm_true) {
-                LOGI("FMR_SevereDensense channel detected:[%d] \n", cur_freq.freq);
+        if (FMR_SevereDensense(tun, cur_freq.freq, cur_freq.rssi) == fm_true) {
+                FMR_TRACE(TR_SCAN_DESENSE, cur_freq.freq, cur_freq.rssi, 1);
                 continue;
         }
+        if (Num >= Limit) {
+            LOGW("scan table full:[%d] \n", Num);
+            break;
+        }
         SortData[Num].ch = cur_freq.freq;
         SortData[Num].rssi = cur_freq.rssi;
         SortData[Num].reserve = 1;
         Num++;
 
-        LOGI("Num++:[%d] \n", Num);
+        FMR_TRACE(TR_SCAN_STATION, cur_freq.freq, cur_freq.rssi, Num);
+        if (cbk != NULL && cbk(cookie, cur_freq.freq, cur_freq.rssi) != 0) {
+            LOGI("scan stopped by caller at:[%d] \n", cur_freq.freq);
+            break;
+        }
     }
 	
     LOGI("get channel no.[%d] \n", Num);
+    FMR_TRACE(TR_SCAN_DONE, Num, fmr_data.scan_stop == fm_true);
     if (Num == 0)/*get nothing*/ {
         *max_cnt = 0;
         FMR_Restore_Search(idx);
         return -1;
     }
 	
-    for (i=0; i<Num; i++)/*debug*/ {
-        LOGI("[%d]:%d \n", i,SortData[i].ch);
+    if (scan_tbl == NULL) {
+        *max_cnt = Num;
+        return 0;
     }
 
     ChannelNo = 0;
@@ -845,14 +1065,22 @@ int FMR_seek_Channels(int idx, int *scan_tbl, int *max_cnt, fm_s32 band_channel_
 }
 
 int FMR_scan(int idx, int *scan_tbl, int *max_cnt, int startFreq, int spacing)
+{
+    return FMR_scan_range(idx, scan_tbl, max_cnt, startFreq, 0, spacing);
+}
+
+static int FMR_scan_band(int idx, int *scan_tbl, int *max_cnt, int startFreq, int endFreq, int spacing,
+                         fmr_scan_cbk cbk, void *cookie)
 {
     fm_s32 ret = 0;
     fm_s32 band_channel_no = 0;
     fm_u8 seek_space = spacing;
     fm_u16 Start_Freq = 8750;
+    fm_u16 End_Freq = 10800;
     fm_u8 NF_Space = 41;
 
     if (startFreq <= 10800 &&  startFreq >= 8750) Start_Freq = startFreq;
+    if (endFreq <= 10800 && endFreq >= Start_Freq) End_Freq = endFreq;
 
     if (fmr_data.cfg_data.band == FM_BAND_JAPAN)/* Japan band      76MHz ~ 90MHz */ {
         band_channel_no = (960-760)/seek_space + 1;
@@ -869,11 +1097,31 @@ int FMR_scan(int idx, int *scan_tbl, int *max_cnt, int startFreq, int spacing)
     }
 
     //  we use hardware seek instead of software tune when scan channels
-    ret = FMR_seek_Channels(idx, scan_tbl, max_cnt, band_channel_no, Start_Freq, seek_space, NF_Space);
+    ret = FMR_seek_Channels(idx, scan_tbl, max_cnt, band_channel_no, Start_Freq, End_Freq, seek_space, NF_Space,
+                            cbk, cookie);
 
     return ret;
 }
 
+/*scan only [startFreq, endFreq], 0 means the band edge on either side*/
+int FMR_scan_range(int idx, int *scan_tbl, int *max_cnt, int startFreq, int endFreq, int spacing)
+{
+    return FMR_scan_band(idx, scan_tbl, max_cnt, startFreq, endFreq, spacing, NULL, NULL);
+}
+
+/*
+ * Same sweep as FMR_scan_range, each station goes to cbk as soon as it's found instead
+ * of into a table. FMR_stop_scan cancels it like any scan.
+ */
+int FMR_scan_stream(int idx, int startFreq, int endFreq, int spacing,
+                    fmr_scan_cbk cbk, void *cookie, int *num)
+{
+    FMR_ASSERT(cbk);
+    FMR_ASSERT(num);
+    *num = 0;
+    return FMR_scan_band(idx, NULL, num, startFreq, endFreq, spacing, cbk, cookie);
+}
+
 int FMR_stop_scan(int idx)
 {
     int ret = -1;
@@ -891,6 +1139,7 @@ int FMR_stop_scan(int idx)
 
 int FMR_turn_on_off_rds(int idx, int onoff)
 {
+    FMR_SPAN("FMR_turn_on_off_rds", onoff);
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).turn_on_off_rds)
@@ -904,6 +1153,7 @@ int FMR_turn_on_off_rds(int idx, int onoff)
 
 int FMR_read_rds_data(int idx, uint16_t *rds_status)
 {
+    FMR_SPAN("FMR_read_rds_data");
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).read_rds_data);
@@ -913,12 +1163,30 @@ int FMR_read_rds_data(int idx, uint16_t *rds_status)
     /*if (ret) {
         LOGE("%s, get no event\n", __func__);
     }*/
-    LOGD("%s, [status=%d] [ret=%d]\n", __func__, *rds_status, ret);
+    FMR_TRACE(TR_RDS_EVENTS, *rds_status, ret);
+    return ret;
+}
+
+/*
+ * Called in a loop by the rds reader, so only failures are logged.
+ */
+int FMR_wait_rds_event(int idx, int timeout_ms)
+{
+    FMR_SPAN("FMR_wait_rds_event", timeout_ms);
+    int ret = 0;
+
+    FMR_ASSERT(FMR_cbk_tbl(idx).wait_rds_event);
+
+    ret = FMR_cbk_tbl(idx).wait_rds_event(FMR_fd(idx), timeout_ms);
+    if (ret < 0) {
+        FMR_TRACE(TR_RDS_WAIT_FAIL, ret);
+    }
     return ret;
 }
 
 int FMR_active_af(int idx, uint16_t *ret_freq)
 {
+    FMR_SPAN("FMR_active_af");
     int ret = 0;
 
     FMR_ASSERT(FMR_cbk_tbl(idx).active_af);
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
 #include "fmr.h"
 
 #ifdef LOG_TAG
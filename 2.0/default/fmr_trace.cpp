@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fmr_trace.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FMR_TRACE_RING_SIZE 1024
+#define FMR_SPAN_RING_SIZE 2048
+
+static const char *const kFormats[TR_EVENT_NUM] = {
+#define FMR_TRACE_FORMAT(id, fmt) fmt,
+    FMR_TRACE_EVENTS(FMR_TRACE_FORMAT)
+#undef FMR_TRACE_FORMAT
+};
+
+/* seqlock per slot, same scheme as the SignalMonitor ring */
+struct fmr_trace_slot {
+    std::atomic<uint64_t> seq{0};  /* odd while written, 2 * (index + 1) once published */
+    std::atomic<int64_t> time{0};
+    std::atomic<int> event{0};
+    std::atomic<int> tid{0};
+    std::atomic<int> args[3];
+};
+
+struct fmr_span_slot {
+    std::atomic<uint64_t> seq{0};  /* as in fmr_trace_slot */
+    std::atomic<int64_t> begin{0};
+    std::atomic<int64_t> end{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int> tid{0};  /* 0 for an async span */
+    std::atomic<int> arg{0};
+};
+
+static fmr_trace_slot g_ring[FMR_TRACE_RING_SIZE];
+static std::atomic<uint64_t> g_next{0};
+static fmr_span_slot g_spans[FMR_SPAN_RING_SIZE];
+static std::atomic<uint64_t> g_nextSpan{0};
+
+int64_t FMR_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int FMR_trace_tid(void)
+{
+    static thread_local int tid = gettid();
+    return tid;
+}
+
+void FMR_trace(enum fmr_trace_event event, int a, int b, int c)
+{
+    uint64_t index = g_next.fetch_add(1, std::memory_order_relaxed);
+    fmr_trace_slot &slot = g_ring[index % FMR_TRACE_RING_SIZE];
+
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time.store(FMR_trace_now(), std::memory_order_relaxed);
+    slot.event.store(event, std::memory_order_relaxed);
+    slot.tid.store(FMR_trace_tid(), std::memory_order_relaxed);
+    slot.args[0].store(a, std::memory_order_relaxed);
+    slot.args[1].store(b, std::memory_order_relaxed);
+    slot.args[2].store(c, std::memory_order_relaxed);
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+}
+
+static void FMR_span_put(const char *name, int64_t begin, int64_t end, int tid, int arg)
+{
+    uint64_t index = g_nextSpan.fetch_add(1, std::memory_order_relaxed);
+    fmr_span_slot &slot = g_spans[index % FMR_SPAN_RING_SIZE];
+
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.tid.store(tid, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+}
+
+void FMR_span(const char *name, int64_t begin, int64_t end, int arg)
+{
+    FMR_span_put(name, begin, end, FMR_trace_tid(), arg);
+}
+
+void FMR_span_async(const char *name, int64_t begin, int64_t end, int arg)
+{
+    FMR_span_put(name, begin, end, 0, arg);
+}
+
+struct fmr_trace_record {
+    int64_t time;
+    int event;
+    int tid;
+    int args[3];
+};
+
+/* false when the record is being written or was overwritten already */
+static bool FMR_trace_read(uint64_t index, struct fmr_trace_record *rec)
+{
+    const fmr_trace_slot &slot = g_ring[index % FMR_TRACE_RING_SIZE];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * (index + 1)) {
+        return false;
+    }
+    rec->time = slot.time.load(std::memory_order_relaxed);
+    rec->event = slot.event.load(std::memory_order_relaxed);
+    rec->tid = slot.tid.load(std::memory_order_relaxed);
+    for (int i = 0; i < 3; i++) {
+        rec->args[i] = slot.args[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == seq && rec->event >= 0 &&
+           rec->event < TR_EVENT_NUM;
+}
+
+struct fmr_span_record {
+    int64_t begin;
+    int64_t end;
+    const char *name;
+    int tid;
+    int arg;
+};
+
+static bool FMR_span_read(uint64_t index, struct fmr_span_record *rec)
+{
+    const fmr_span_slot &slot = g_spans[index % FMR_SPAN_RING_SIZE];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * (index + 1)) {
+        return false;
+    }
+    rec->begin = slot.begin.load(std::memory_order_relaxed);
+    rec->end = slot.end.load(std::memory_order_relaxed);
+    rec->name = slot.name.load(std::memory_order_relaxed);
+    rec->tid = slot.tid.load(std::memory_order_relaxed);
+    rec->arg = slot.arg.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == seq && rec->name != nullptr;
+}
+
+void FMR_trace_dump(int fd)
+{
+    uint64_t end = g_next.load(std::memory_order_acquire);
+    uint64_t begin = end > FMR_TRACE_RING_SIZE ? end - FMR_TRACE_RING_SIZE : 0;
+    int64_t now = FMR_trace_now();
+    int lost = 0;
+
+    dprintf(fd, "fm trace: %llu records so far, the last %llu:\n", (unsigned long long)end,
+            (unsigned long long)(end - begin));
+    for (uint64_t i = begin; i < end; i++) {
+        struct fmr_trace_record rec;
+        if (!FMR_trace_read(i, &rec)) {
+            lost++;
+            continue;
+        }
+
+        /* age of the record */
+        dprintf(fd, "-%lld.%03lldms [%d] ", (long long)((now - rec.time) / 1000000),
+                (long long)((now - rec.time) / 1000 % 1000), rec.tid);
+        dprintf(fd, kFormats[rec.event], rec.args[0], rec.args[1], rec.args[2]);
+        dprintf(fd, "\n");
+    }
+    if (lost) {
+        dprintf(fd, "%d records overwritten while dumping\n", lost);
+    }
+}
+
+/* chrome trace timestamps are in us */
+#define FMR_JSON_US(ns) (long long)((ns) / 1000), (long long)((ns) % 1000)
+
+void FMR_trace_dump_json(int fd)
+{
+    int pid = getpid();
+    const char *sep = "";
+
+    dprintf(fd, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    uint64_t end = g_nextSpan.load(std::memory_order_acquire);
+    uint64_t begin = end > FMR_SPAN_RING_SIZE ? end - FMR_SPAN_RING_SIZE : 0;
+    for (uint64_t i = begin; i < end; i++) {
+        struct fmr_span_record rec;
+        if (!FMR_span_read(i, &rec)) {
+            continue;
+        }
+        if (rec.tid != 0) {
+            dprintf(fd, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld.%03lld,"
+                    "\"dur\":%lld.%03lld,\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%d}}",
+                    sep, rec.name, FMR_JSON_US(rec.begin), FMR_JSON_US(rec.end - rec.begin),
+                    pid, rec.tid, rec.arg);
+        } else {
+            /* async: a begin/end pair, id keeps overlapping ones apart */
+            dprintf(fd, "%s\n{\"name\":\"%s\",\"cat\":\"async\",\"ph\":\"b\",\"id\":%llu,"
+                    "\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%d}}",
+                    sep, rec.name, (unsigned long long)i, FMR_JSON_US(rec.begin), pid, pid,
+                    rec.arg);
+            dprintf(fd, ",\n{\"name\":\"%s\",\"cat\":\"async\",\"ph\":\"e\",\"id\":%llu,"
+                    "\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d}",
+                    rec.name, (unsigned long long)i, FMR_JSON_US(rec.end), pid, pid);
+        }
+        sep = ",";
+    }
+
+    end = g_next.load(std::memory_order_acquire);
+    begin = end > FMR_TRACE_RING_SIZE ? end - FMR_TRACE_RING_SIZE : 0;
+    for (uint64_t i = begin; i < end; i++) {
+        struct fmr_trace_record rec;
+        if (!FMR_trace_read(i, &rec)) {
+            continue;
+        }
+        /* the formats hold no quote nor backslash, the text needs no escaping */
+        char text[128];
+        snprintf(text, sizeof(text), kFormats[rec.event], rec.args[0], rec.args[1],
+                 rec.args[2]);
+        dprintf(fd, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld.%03lld,"
+                "\"pid\":%d,\"tid\":%d}",
+                sep, text, FMR_JSON_US(rec.time), pid, rec.tid);
+        sep = ",";
+    }
+    dprintf(fd, "\n]}\n");
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FMR_TRACE_H__
+#define __FMR_TRACE_H__
+
+#include <stdint.h>
+
+/*
+ * Binary trace of the hot seek/scan/rds paths.
+ *
+ * A record is an event id and three ints, written lock free into a ring; nothing is
+ * formatted until the ring is dumped, so tracing costs a few stores where a LOGx
+ * used to cost a format and a logd write. The format of each event is in the table
+ * below, it receives the three ints in order.
+ */
+#define FMR_TRACE_EVENTS(E) \
+    E(TR_TUNE,          "tune: freq %d, ret %d") \
+    E(TR_SEEK_STEP,     "seek step: freq %d, last %d, ret %d") \
+    E(TR_SEEK_RESULT,   "seek: from %d to %d, ret %d") \
+    E(TR_SEEK_WEAK,     "seek weak: freq %d, rssi %d, threshold %d") \
+    E(TR_SCAN_STATION,  "scan station: freq %d, rssi %d, #%d") \
+    E(TR_SCAN_DESENSE,  "scan desense: freq %d, rssi %d, severe %d") \
+    E(TR_SCAN_DONE,     "scan done: %d stations, stopped %d") \
+    E(TR_RDS_EVENTS,    "rds events: 0x%x, ret %d") \
+    E(TR_RDS_MISSING,   "rds missing: %d (0 ps, 1 rt, 2 pi), events 0x%x") \
+    E(TR_RDS_WAIT_FAIL, "rds wait failed: ret %d") \
+    E(TR_AF_CHECK,      "af check: freq %d, pamd %d, dropout %dms")
+
+enum fmr_trace_event {
+#define FMR_TRACE_ENUM(id, fmt) id,
+    FMR_TRACE_EVENTS(FMR_TRACE_ENUM)
+#undef FMR_TRACE_ENUM
+    TR_EVENT_NUM
+};
+
+void FMR_trace(enum fmr_trace_event event, int a, int b, int c);
+/* formats the ring, oldest record first, into fd */
+void FMR_trace_dump(int fd);
+
+/*
+ * Spans: named intervals of the tune/seek/scan/rds pipelines, from the binder entry
+ * down to the ioctl, kept in a second ring. Spans of one thread nest by time.
+ * name must be a string literal, only the pointer is kept.
+ */
+int64_t FMR_trace_now(void);  /* CLOCK_MONOTONIC, ns */
+void FMR_span(const char *name, int64_t begin, int64_t end, int arg);
+/* an interval no thread spends running, Eg. a task waiting in a queue */
+void FMR_span_async(const char *name, int64_t begin, int64_t end, int arg);
+/* both rings as chrome trace event json, for chrome://tracing or ui.perfetto.dev */
+void FMR_trace_dump_json(int fd);
+
+/* span of the enclosing scope */
+class FmrSpan {
+  public:
+    explicit FmrSpan(const char *name, int arg = 0)
+        : mName(name), mArg(arg), mBegin(FMR_trace_now()) {}
+    ~FmrSpan() { FMR_span(mName, mBegin, FMR_trace_now(), mArg); }
+
+  private:
+    const char *const mName;
+    const int mArg;
+    const int64_t mBegin;
+
+    FmrSpan(const FmrSpan &) = delete;
+    FmrSpan &operator=(const FmrSpan &) = delete;
+};
+
+#ifdef FMR_TRACE_DISABLED
+#define FMR_TRACE(event, ...) do { } while (0)
+#define FMR_SPAN(name, ...) do { } while (0)
+#define FMR_SPAN_ASYNC(name, begin, end, arg) do { (void)(name); } while (0)
+#else
+#define FMR_TRACE_3(event, a, b, c, ...) FMR_trace(event, (int)(a), (int)(b), (int)(c))
+/* FMR_TRACE(event, up to three ints), missing ones are 0 */
+#define FMR_TRACE(event, ...) FMR_TRACE_3(event, ##__VA_ARGS__, 0, 0, 0)
+#define FMR_SPAN_VAR2(line) fmr_span_##line
+#define FMR_SPAN_VAR(line) FMR_SPAN_VAR2(line)
+/* FMR_SPAN(name[, int arg]): span from here to the end of the scope */
+#define FMR_SPAN(name, ...) FmrSpan FMR_SPAN_VAR(__LINE__)(name, ##__VA_ARGS__)
+#define FMR_SPAN_ASYNC(name, begin, end, arg) FMR_span_async(name, begin, end, arg)
+#endif
+
+#endif
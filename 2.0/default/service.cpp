@@ -16,6 +16,7 @@
 #define LOG_TAG "Vendor.BcRadioDef.service"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <hidl/HidlTransportSupport.h>
 
 #include "BroadcastRadio.h"
@@ -34,6 +35,11 @@ int main(int /* argc */, char** /* argv */) {
     auto status = broadcastRadio.registerAsService();
     CHECK_EQ(status, android::OK) << "Failed to register Broadcast Radio HAL implementation";
 
+    // warm start: get the device ready before the first openSession
+    if (android::base::GetBoolProperty("persist.vendor.fm.warmstart", false)) {
+        broadcastRadio.prewarm();
+    }
+
     joinRpcThreadpool();
     return 1;  // joinRpcThreadpool shouldn't exit
 }
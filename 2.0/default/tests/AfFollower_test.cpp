@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../AfFollower.h"
+#include "../SignalMonitor.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <map>
+
+using namespace vendor::sprd::hardware::broadcastradio::V2_0::implementation;
+using std::chrono::milliseconds;
+
+/*
+ * The chip as AfFollower sees it: the bridge calls below stand in for fm_hal_bridge.cpp,
+ * each frequency (10kHz units) has a fixed PAMD.
+ */
+namespace {
+struct FakeChip {
+    std::map<int, int> pamd;
+    int freq = 0;
+    int tunes = 0;
+    bool muted = false;
+    bool rdsOn = true;
+} gChip;
+}  // namespace
+
+bool tune(float freq) {
+    gChip.freq = static_cast<int>(freq) / 10;
+    gChip.tunes++;
+    return true;
+}
+
+int setMute(bool mute) {
+    gChip.muted = mute;
+    return 0;
+}
+
+int setRds(bool rdson) {
+    gChip.rdsOn = rdson;
+    return 0;
+}
+
+int getPamd() {
+    auto it = gChip.pamd.find(gChip.freq);
+    return it != gChip.pamd.end() ? it->second : 0;
+}
+
+// never started, checks only pause and resume it
+SignalMonitor& getSignalMonitor() {
+    static SignalMonitor monitor([](SignalSample*) { return false; });
+    return monitor;
+}
+
+namespace {
+
+constexpr uint16_t kHome = 9850;
+
+RDSData_Struct makeAfList(std::initializer_list<int16_t> afs) {
+    RDSData_Struct rds;
+    memset(&rds, 0, sizeof(rds));
+    for (int16_t af : afs) {
+        rds.AF_Data.AF[1][rds.AF_Data.AF_Num++] = af;
+    }
+    return rds;
+}
+
+class AfFollowerTest : public ::testing::Test {
+  protected:
+    AfFollower mFollower;
+
+    void SetUp() override {
+        gChip = FakeChip();
+        gChip.freq = kHome;
+        mFollower.setEnabled(true);
+        mFollower.reset(kHome);
+    }
+};
+
+}  // namespace
+
+TEST_F(AfFollowerTest, DisabledNeverTouchesChip) {
+    mFollower.setEnabled(false);
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(0, mFollower.poll(kHome, 2));
+    EXPECT_EQ(0, gChip.tunes);
+}
+
+TEST_F(AfFollowerTest, CleanChannelNeverChecks) {
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(0, mFollower.poll(kHome, 20));
+    EXPECT_EQ(0, gChip.tunes);
+    EXPECT_EQ(0u, mFollower.stats().checks);
+}
+
+// degraded but still listenable: one muted check, back on the station, no switch
+TEST_F(AfFollowerTest, DegradedChecksOneCandidatePerInterval) {
+    gChip.pamd[10110] = 20;
+    mFollower.update(makeAfList({10110, 10350}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(0, mFollower.poll(kHome, 10));
+    EXPECT_EQ(1u, mFollower.stats().checks);
+    EXPECT_EQ(kHome, gChip.freq);
+    EXPECT_FALSE(gChip.muted);
+    EXPECT_TRUE(gChip.rdsOn);
+
+    EXPECT_EQ(0, mFollower.poll(kHome, 10));
+    EXPECT_EQ(1u, mFollower.stats().checks);
+}
+
+TEST_F(AfFollowerTest, BadChannelSwitchesToGoodAf) {
+    gChip.pamd[10110] = 20;
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(10110, mFollower.poll(kHome, 5));
+}
+
+TEST_F(AfFollowerTest, WeakAfIsNotWorthIt) {
+    gChip.pamd[10110] = 9;
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(0, mFollower.poll(kHome, 5));
+}
+
+TEST_F(AfFollowerTest, DriverHintSwitchesBeforeBadChannel) {
+    gChip.pamd[10110] = 20;
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST | RDS_EVENT_AF);
+
+    EXPECT_EQ(10110, mFollower.poll(kHome, 12));
+}
+
+TEST_F(AfFollowerTest, ListSkipsOwnAndEmptyEntries) {
+    gChip.pamd[10110] = 20;
+    mFollower.update(makeAfList({0, kHome, 10110}), RDS_EVENT_AF_LIST);
+
+    EXPECT_EQ(10110, mFollower.poll(kHome, 5));
+    EXPECT_EQ(1u, mFollower.stats().checks);
+}
+
+// the channel left becomes an alternative of the new one
+TEST_F(AfFollowerTest, SwitchKeepsPreviousChannelAsAf) {
+    gChip.pamd[10110] = 20;
+    mFollower.update(makeAfList({10110}), RDS_EVENT_AF_LIST);
+    ASSERT_EQ(10110, mFollower.poll(kHome, 5));
+
+    mFollower.onSwitched(10110, milliseconds(30));
+    EXPECT_EQ(10110, mFollower.freq());
+    EXPECT_EQ(1u, mFollower.stats().switches);
+    EXPECT_EQ(milliseconds(30), mFollower.stats().lastSwitchDropout);
+
+    // previous channel measured 5, not good enough to switch back to
+    EXPECT_EQ(0, mFollower.poll(10110, 5));
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../ProgramInfoBuilder.h"
+
+#include <broadcastradio-utils-2x/Utils.h>
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+using namespace vendor::sprd::hardware::broadcastradio::V2_0::implementation;
+using namespace android::hardware::broadcastradio;
+
+namespace {
+
+constexpr uint16_t kTextEvents =
+    RDS_EVENT_PROGRAMNAME | RDS_EVENT_LAST_RADIOTEXT | RDS_EVENT_PTY_CODE;
+
+RDSData_Struct makeRds(const char* ps, const char* rt) {
+    RDSData_Struct rds;
+    memset(&rds, 0, sizeof(rds));
+    memset(rds.PS_Data.PS[3], ' ', sizeof(rds.PS_Data.PS[3]));
+    memcpy(rds.PS_Data.PS[3], ps, std::min(strlen(ps), sizeof(rds.PS_Data.PS[3])));
+    memset(rds.RT_Data.TextData[3], ' ', sizeof(rds.RT_Data.TextData[3]));
+    memcpy(rds.RT_Data.TextData[3], rt, std::min(strlen(rt), sizeof(rds.RT_Data.TextData[3])));
+    rds.RT_Data.TextLength = sizeof(rds.RT_Data.TextData[3]);
+    rds.PTY = 10;
+    rds.PI = 0xC201;
+    return rds;
+}
+
+const Metadata* findMetadata(const ProgramInfo& info, MetadataKey key) {
+    for (const auto& m : info.metadata) {
+        if (m.key == static_cast<uint32_t>(key)) return &m;
+    }
+    return nullptr;
+}
+
+size_t countIds(const ProgramSelector& sel, IdentifierType type) {
+    return utils::getAllIds(sel, type).size();
+}
+
+}  // namespace
+
+TEST(ProgramInfoBuilderTest, ResetDropsPreviousStation) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    builder.update(makeRds("RADIO 1", "Song"), kTextEvents | RDS_EVENT_PI_CODE, 50);
+
+    const ProgramInfo& info = builder.reset(utils::make_selector_amfm(101100));
+    EXPECT_EQ(101100u, utils::getId(info.selector, IdentifierType::AMFM_FREQUENCY));
+    EXPECT_EQ(0u, countIds(info.selector, IdentifierType::RDS_PI));
+    EXPECT_EQ(0u, info.metadata.size());
+    EXPECT_EQ(0u, info.signalQuality);
+    EXPECT_NE(0u, info.infoFlags & static_cast<uint32_t>(ProgramInfoFlags::TUNED));
+}
+
+TEST(ProgramInfoBuilderTest, FillsTextAndPty) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    auto rds = makeRds(" RADIO\x01", "Now playing");
+
+    const ProgramInfo& info = builder.update(rds, kTextEvents, 70);
+    ASSERT_NE(nullptr, findMetadata(info, MetadataKey::RDS_PS));
+    EXPECT_EQ("RADIO", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ("Now playing", std::string(findMetadata(info, MetadataKey::RDS_RT)->stringValue));
+    EXPECT_EQ(10, findMetadata(info, MetadataKey::RDS_PTY)->intValue);
+    EXPECT_EQ(70u, info.signalQuality);
+}
+
+TEST(ProgramInfoBuilderTest, KeepsFieldsNotInEvents) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    builder.update(makeRds("RADIO 1", "First"), kTextEvents, 70);
+
+    const ProgramInfo& info =
+        builder.update(makeRds("OTHER", "Second"), RDS_EVENT_LAST_RADIOTEXT, 70);
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ("Second", std::string(findMetadata(info, MetadataKey::RDS_RT)->stringValue));
+}
+
+// a field the station hasn't sent yet isn't there, rather than there and empty
+TEST(ProgramInfoBuilderTest, RtOnlyAddsRt) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+
+    const ProgramInfo& info =
+        builder.update(makeRds("RADIO 1", "Now playing"), RDS_EVENT_LAST_RADIOTEXT, 70);
+    ASSERT_EQ(1u, info.metadata.size());
+    EXPECT_EQ("Now playing", std::string(findMetadata(info, MetadataKey::RDS_RT)->stringValue));
+    EXPECT_EQ(nullptr, findMetadata(info, MetadataKey::RDS_PS));
+    EXPECT_EQ(nullptr, findMetadata(info, MetadataKey::RDS_PTY));
+
+    builder.update(makeRds("RADIO 1", "Now playing"), RDS_EVENT_PROGRAMNAME, 70);
+    EXPECT_EQ(2u, info.metadata.size());
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ(nullptr, findMetadata(info, MetadataKey::RDS_PTY));
+}
+
+// journaled PS/PI stay until the chip sends its own, a read with nothing new keeps them
+TEST(ProgramInfoBuilderTest, RestoredRdsSurvivesEmptyRead) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    ProgramInfo restored = builder.restore(0xC201, "RADIO 1");
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(restored, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ(0xC201u, utils::getId(restored.selector, IdentifierType::RDS_PI));
+
+    const ProgramInfo& info = builder.update(makeRds("", ""), 0, 0);
+    ASSERT_NE(nullptr, findMetadata(info, MetadataKey::RDS_PS));
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ(0xC201u, utils::getId(info.selector, IdentifierType::RDS_PI));
+    EXPECT_FALSE(isRdsUpdateNeeded(info, restored));
+
+    builder.update(makeRds("RADIO 2", ""), RDS_EVENT_PROGRAMNAME, 0);
+    EXPECT_EQ("RADIO 2", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+}
+
+TEST(ProgramInfoBuilderTest, PiIsOneSecondaryId) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    auto rds = makeRds("", "");
+
+    builder.update(rds, RDS_EVENT_PI_CODE, 0);
+    rds.PI = 0xC202;
+    const ProgramInfo& info = builder.update(rds, RDS_EVENT_PI_CODE, 0);
+    ASSERT_EQ(1u, countIds(info.selector, IdentifierType::RDS_PI));
+    EXPECT_EQ(0xC202u, utils::getId(info.selector, IdentifierType::RDS_PI));
+}
+
+TEST(ProgramInfoBuilderTest, FlagsFollowRds) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    auto rds = makeRds("", "");
+    rds.RDSFlag.Stereo = 1;
+    rds.RDSFlag.TA = 1;
+
+    uint32_t flags = builder.update(rds, RDS_EVENT_FLAGS, 0).infoFlags;
+    EXPECT_NE(0u, flags & static_cast<uint32_t>(ProgramInfoFlags::TUNED));
+    EXPECT_NE(0u, flags & static_cast<uint32_t>(ProgramInfoFlags::STEREO));
+    EXPECT_NE(0u, flags & static_cast<uint32_t>(ProgramInfoFlags::TRAFFIC_ANNOUNCEMENT));
+    EXPECT_EQ(0u, flags & static_cast<uint32_t>(ProgramInfoFlags::TRAFFIC_PROGRAM));
+
+    rds.RDSFlag.TA = 0;
+    flags = builder.update(rds, RDS_EVENT_FLAGS, 0).infoFlags;
+    EXPECT_EQ(0u, flags & static_cast<uint32_t>(ProgramInfoFlags::TRAFFIC_ANNOUNCEMENT));
+}
+
+// steady rds reuses the slots and strings it has, nothing is reallocated
+TEST(ProgramInfoBuilderTest, SteadyRdsKeepsStorage) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    auto rds = makeRds("RADIO 1", "Now playing");
+
+    const ProgramInfo& info = builder.update(rds, kTextEvents | RDS_EVENT_PI_CODE, 60);
+    const Metadata* slots = info.metadata.data();
+    const char* ps = findMetadata(info, MetadataKey::RDS_PS)->stringValue.c_str();
+    const ProgramIdentifier* ids = info.selector.secondaryIds.data();
+
+    builder.update(rds, kTextEvents | RDS_EVENT_PI_CODE, 61);
+    EXPECT_EQ(slots, info.metadata.data());
+    EXPECT_EQ(ps, findMetadata(info, MetadataKey::RDS_PS)->stringValue.c_str());
+    EXPECT_EQ(ids, info.selector.secondaryIds.data());
+}
+
+TEST(ProgramInfoBuilderTest, IconComesAndGoes) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+
+    builder.setIcon(7);
+    const ProgramInfo& info = builder.update(makeRds("RADIO 1", ""), kTextEvents, 0);
+    ASSERT_NE(nullptr, findMetadata(info, MetadataKey::STATION_ICON));
+    EXPECT_EQ(7, findMetadata(info, MetadataKey::STATION_ICON)->intValue);
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+
+    builder.setIcon(0);
+    EXPECT_EQ(nullptr, findMetadata(builder.get(), MetadataKey::STATION_ICON));
+    EXPECT_EQ("RADIO 1", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+
+    // the entries that moved up are still updated in place
+    builder.update(makeRds("RADIO 2", "Now playing"), kTextEvents, 0);
+    EXPECT_EQ(3u, info.metadata.size());
+    EXPECT_EQ("RADIO 2", std::string(findMetadata(info, MetadataKey::RDS_PS)->stringValue));
+    EXPECT_EQ("Now playing", std::string(findMetadata(info, MetadataKey::RDS_RT)->stringValue));
+}
+
+TEST(ProgramInfoBuilderTest, SignalQualityRange) {
+    EXPECT_EQ(0u, rssiToSignalQuality(-120));
+    EXPECT_EQ(100u, rssiToSignalQuality(-40));
+    EXPECT_EQ(50u, rssiToSignalQuality(-85));
+}
+
+TEST(ProgramInfoBuilderTest, UpdateNeededIgnoresQualityJitter) {
+    ProgramInfoBuilder builder;
+    builder.reset(utils::make_selector_amfm(98500));
+    ProgramInfo current = builder.update(makeRds("RADIO 1", "First"), kTextEvents, 60);
+
+    ProgramInfo next = current;
+    next.signalQuality = 62;
+    EXPECT_FALSE(isRdsUpdateNeeded(next, current));
+    next.signalQuality = 70;
+    EXPECT_TRUE(isRdsUpdateNeeded(next, current));
+
+    next = builder.update(makeRds("RADIO 1", "Second"), kTextEvents, 60);
+    EXPECT_TRUE(isRdsUpdateNeeded(next, current));
+}
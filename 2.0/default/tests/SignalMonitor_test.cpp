@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../SignalMonitor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+namespace {
+
+// a chip whose rssi is the number of reads so far
+class SignalMonitorTest : public ::testing::Test {
+  protected:
+    std::atomic<int> mReads{0};
+    SignalMonitor mMonitor{[this](SignalSample* sample) {
+        sample->rssi = ++mReads;
+        sample->snr = 0;
+        sample->bler = 0;
+        return true;
+    }};
+};
+
+}  // namespace
+
+TEST_F(SignalMonitorTest, LatestReadsChipOnce) {
+    SignalSample sample;
+    ASSERT_TRUE(mMonitor.latest(&sample));
+    EXPECT_EQ(1, sample.rssi);
+    ASSERT_TRUE(mMonitor.latest(&sample));
+    EXPECT_EQ(1, sample.rssi);
+    EXPECT_EQ(1, mReads);
+}
+
+TEST_F(SignalMonitorTest, PausedNeitherSamplesNorAnswers) {
+    SignalSample sample;
+    ASSERT_TRUE(mMonitor.latest(&sample));
+
+    mMonitor.pause();
+    EXPECT_FALSE(mMonitor.latest(&sample));
+    EXPECT_FALSE(mMonitor.newest(&sample));
+    EXPECT_EQ(0, mMonitor.window(std::chrono::seconds(5)).count);
+    EXPECT_EQ(1, mReads);
+}
+
+TEST_F(SignalMonitorTest, ResumeDropsSamplesOfChannelLeft) {
+    SignalSample sample;
+    ASSERT_TRUE(mMonitor.latest(&sample));
+
+    mMonitor.pause();
+    mMonitor.resume();
+    EXPECT_FALSE(mMonitor.newest(&sample));
+    ASSERT_TRUE(mMonitor.latest(&sample));
+    EXPECT_EQ(2, sample.rssi);
+    EXPECT_EQ(1, mMonitor.window(std::chrono::seconds(5)).count);
+}
+
+TEST_F(SignalMonitorTest, PauseNests) {
+    SignalSample sample;
+    mMonitor.pause();
+    mMonitor.pause();
+    mMonitor.resume();
+    EXPECT_FALSE(mMonitor.latest(&sample));
+    mMonitor.resume();
+    EXPECT_TRUE(mMonitor.latest(&sample));
+}
+
+TEST_F(SignalMonitorTest, ThreadSkipsPausedPeriods) {
+    mMonitor.setPeriod(std::chrono::milliseconds(50));
+    mMonitor.pause();
+    mMonitor.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0, mReads);
+    mMonitor.resume();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    mMonitor.stop();
+    EXPECT_GT(mReads, 0);
+}
@@ -41,6 +41,12 @@ JNIHelper::JNIHelper(JNIEnv *env)
 
 JNIHelper::~JNIHelper()
 {
+#ifdef FM_JNI_REF_AUDIT
+    ALOGD("local refs: %d created, %d deleted", mAudit.created, mAudit.deleted);
+    if (mAudit.created != mAudit.deleted) {
+        ALOGW("local refs unbalanced: %d leaked", mAudit.created - mAudit.deleted);
+    }
+#endif
     if (mVM != NULL) {
         // mVM->DetachCurrentThread();  /* 'attempting to detach while still running code' */
         mVM = NULL;                     /* not really required; but may help debugging */
@@ -70,8 +76,8 @@ void JNIHelper::throwException(const char *message, int line)
 
     const char *className = "java/lang/Exception";
 
-    jclass exClass = mEnv->FindClass(className );
-    if ( exClass == NULL ) {
+    JNIObject<jclass> exClass(*this, mEnv->FindClass(className));
+    if (exClass == NULL) {
         ALOGE("Could not find exception class to throw error");
         ALOGE("error at line %d: %s", line, message);
         return;
@@ -130,13 +136,12 @@ jlong JNIHelper::getLongField(jobject obj, const char *name)
 
 JNIObject<jstring> JNIHelper::getStringField(jobject obj, const char *name)
 {
-    JNIObject<jobject> m = getObjectField(obj, name, "Ljava/lang/String;");
-    if (m == NULL) {
+    JNIObject<jstring> m(*this, (jstring)getFieldObject(obj, name, "Ljava/lang/String;"));
+    if (m.isNull() && !mEnv->ExceptionCheck()) {
         THROW(*this, "Error in accessing field");
-        return JNIObject<jstring>(*this, NULL);
     }
 
-    return JNIObject<jstring>(*this, (jstring)m.detach());
+    return m;
 }
 /*
 bool JNIHelper::getStringFieldValue(jobject obj, const char *name, char *buf, int size)
@@ -148,8 +153,7 @@ bool JNIHelper::getStringFieldValue(jobject obj, const char *name, char *buf, in
         return 0;
     }
 
-    JNIObject<jobject> value(*this, mEnv->GetObjectField(obj, field));
-    JNIObject<jstring> string(*this, (jstring)value.clone());
+    JNIObject<jstring> string(*this, (jstring)mEnv->GetObjectField(obj, field));
     ScopedUtfChars chars(mEnv, string);
 
     const char *utf = chars.c_str();
@@ -187,28 +191,26 @@ jlong JNIHelper::getStaticLongField(jclass cls, const char *name)
     return mEnv->GetStaticLongField(cls, field);
 }
 
-JNIObject<jobject> JNIHelper::getObjectField(jobject obj, const char *name, const char *type)
+jobject JNIHelper::getFieldObject(jobject obj, const char *name, const char *type)
 {
     JNIObject<jclass> cls(*this, mEnv->GetObjectClass(obj));
     jfieldID field = mEnv->GetFieldID(cls, name, type);
     if (field == 0) {
         THROW(*this, "Error in accessing field");
-        return JNIObject<jobject>(*this, NULL);
+        return NULL;
     }
 
-    return JNIObject<jobject>(*this, mEnv->GetObjectField(obj, field));
+    return mEnv->GetObjectField(obj, field);
 }
 
-JNIObject<jobjectArray> JNIHelper::getArrayField(jobject obj, const char *name, const char *type)
+JNIObject<jobject> JNIHelper::getObjectField(jobject obj, const char *name, const char *type)
 {
-    JNIObject<jclass> cls(*this, mEnv->GetObjectClass(obj));
-    jfieldID field = mEnv->GetFieldID(cls, name, type);
-    if (field == 0) {
-        THROW(*this, "Error in accessing field");
-        return JNIObject<jobjectArray>(*this, NULL);
-    }
+    return JNIObject<jobject>(*this, getFieldObject(obj, name, type));
+}
 
-    return JNIObject<jobjectArray>(*this, (jobjectArray)mEnv->GetObjectField(obj, field));
+JNIObject<jobjectArray> JNIHelper::getArrayField(jobject obj, const char *name, const char *type)
+{
+    return JNIObject<jobjectArray>(*this, (jobjectArray)getFieldObject(obj, name, type));
 }
 
 jlong JNIHelper::getLongArrayField(jobject obj, const char *name, int index)
@@ -554,13 +556,12 @@ JNIObject<jobjectArray> JNIHelper::createObjectArray(const char *className, int
         return JNIObject<jobjectArray>(*this, NULL);
     }
 
-    JNIObject<jobject> array(*this, mEnv->NewObjectArray(num, cls.get(), NULL));
-    if (array.get() == NULL) {
+    JNIObject<jobjectArray> array(*this, mEnv->NewObjectArray(num, cls.get(), NULL));
+    if (array.isNull()) {
         ALOGE("Error in creating array of class %s", className);
-        return JNIObject<jobjectArray>(*this, NULL);
     }
 
-    return JNIObject<jobjectArray>(*this, (jobjectArray)array.detach());
+    return array;
 }
 
 JNIObject<jobject> JNIHelper::getObjectArrayElement(jobjectArray array, int index)
@@ -4,17 +4,22 @@
 
 class JNIHelper;
 
+/*
+ * Owns one local reference. Move-only: passing one around never creates a reference,
+ * clone() is the only way to get a second one.
+ */
 template<typename T>
 class JNIObject {
 protected:
-    JNIHelper &mHelper;
+    JNIHelper *mHelper;
     T mObj;
 public:
     JNIObject(JNIHelper &helper, T obj);
-    JNIObject(const JNIObject<T>& rhs);
+    JNIObject(JNIObject<T>&& rhs);
+    JNIObject(const JNIObject<T>& rhs) = delete;
     virtual ~JNIObject();
     JNIHelper& getHelper() const {
-        return mHelper;
+        return *mHelper;
     }
     T get() const {
         return mObj;
@@ -26,18 +31,18 @@ public:
         return mObj == NULL;
     }
     void release();
-    T detach() {
-        T tObj = mObj;
-        mObj = NULL;
-        return tObj;
-    }
-    T clone();
-    JNIObject<T>& operator = (const JNIObject<T>& rhs) {
-        release();
-        mHelper = rhs.mHelper;
-        mObj = rhs.mObj;
+    T detach();
+    JNIObject<T> clone() const;
+    JNIObject<T>& operator = (JNIObject<T>&& rhs) {
+        if (this != &rhs) {
+            release();
+            mHelper = rhs.mHelper;
+            mObj = rhs.mObj;
+            rhs.mObj = NULL;
+        }
         return *this;
     }
+    JNIObject<T>& operator = (const JNIObject<T>& rhs) = delete;
     void print() {
         ALOGD("holding %p", mObj);
     }
@@ -47,9 +52,22 @@ private:
     JNIObject(const JNIObject<T2>& rhs);
 };
 
+/*
+ * Build with -DFM_JNI_REF_AUDIT to count the local references each helper adopts and
+ * deletes: the destructor logs both, and warns when they don't pair up. A helper lives
+ * for one native call, so the counts are per call.
+ */
+struct JNIRefAudit {
+    int created = 0;    // adopted by a JNIObject, or made by clone()
+    int deleted = 0;    // deleted, or detached to the caller
+};
+
 class JNIHelper {
     JavaVM *mVM;
     JNIEnv *mEnv;
+#ifdef FM_JNI_REF_AUDIT
+    JNIRefAudit mAudit;
+#endif
 
 public :
     JNIHelper(JavaVM *vm);
@@ -109,7 +127,26 @@ public :
     jobject newGlobalRef(jobject obj);
     void deleteGlobalRef(jobject obj);
 
+#ifdef FM_JNI_REF_AUDIT
+    const JNIRefAudit& audit() const { return mAudit; }
+#endif
+    void auditCreated(jobject obj) {
+#ifdef FM_JNI_REF_AUDIT
+        if (obj != NULL) mAudit.created++;
+#else
+        (void) obj;
+#endif
+    }
+    void auditDeleted() {
+#ifdef FM_JNI_REF_AUDIT
+        mAudit.deleted++;
+#endif
+    }
+
 private:
+    // local ref of the field value, owned by the caller
+    jobject getFieldObject(jobject obj, const char *name, const char *type);
+
     /* Jni wrappers */
     friend class JNIObject<jobject>;
     friend class JNIObject<jstring>;
@@ -124,14 +161,16 @@ private:
 
 template<typename T>
 JNIObject<T>::JNIObject(JNIHelper &helper, T obj)
-    : mHelper(helper), mObj(obj)
-{ }
+    : mHelper(&helper), mObj(obj)
+{
+    mHelper->auditCreated(mObj);
+}
 
 template<typename T>
-JNIObject<T>::JNIObject(const JNIObject<T>& rhs)
-    : mHelper(rhs.mHelper), mObj(NULL)
+JNIObject<T>::JNIObject(JNIObject<T>&& rhs)
+    : mHelper(rhs.mHelper), mObj(rhs.mObj)
 {
-    mObj = (T)mHelper.newLocalRef(rhs.mObj);
+    rhs.mObj = NULL;
 }
 
 template<typename T>
@@ -143,15 +182,27 @@ template<typename T>
 void JNIObject<T>::release()
 {
     if (mObj != NULL) {
-        mHelper.deleteLocalRef(mObj);
+        mHelper->deleteLocalRef(mObj);
+        mHelper->auditDeleted();
         mObj = NULL;
     }
 }
 
 template<typename T>
-T JNIObject<T>::clone()
+T JNIObject<T>::detach()
+{
+    T tObj = mObj;
+    if (mObj != NULL) {
+        mHelper->auditDeleted();
+    }
+    mObj = NULL;
+    return tObj;
+}
+
+template<typename T>
+JNIObject<T> JNIObject<T>::clone() const
 {
-    return mHelper.newLocalRef(mObj);
+    return JNIObject<T>(*mHelper, (T)mHelper->newLocalRef(mObj));
 }
 
 //}
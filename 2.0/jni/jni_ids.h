@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __FM_JNI_IDS_H__
+#define __FM_JNI_IDS_H__
+
+#include <jni.h>
+
+/*
+ * Field IDs of the parameter classes of FmNative, resolved once in JNI_OnLoad.
+ *
+ * Each class is listed as F(name, JniType, ctype, signature) entries. FM_JNI_CLASS
+ * expands a list to a struct holding a global ref of the class, one jfieldID per field
+ * and typed get_<name>/set_<name> accessors, so a parameter round trip costs the field
+ * accesses only, not a GetObjectClass + GetFieldID by name per field.
+ */
+
+#define FM_SEEK_CRITERIA_FIELDS(F)              \
+    F(rssi_th, Int, jint, "I")                  \
+    F(snr_th, Byte, jbyte, "B")                 \
+    F(freq_offset_th, Int, jint, "I")           \
+    F(pilot_power_th, Int, jint, "I")           \
+    F(noise_power_th, Int, jint, "I")
+
+#define FM_AUDIO_THRESHOLD_FIELDS(F)            \
+    F(hbound, Int, jint, "I")                   \
+    F(lbound, Int, jint, "I")                   \
+    F(power_th, Int, jint, "I")                 \
+    F(phyt, Byte, jbyte, "B")                   \
+    F(snr_th, Byte, jbyte, "B")
+
+#define FM_REG_CTL_FIELDS(F)                    \
+    F(err, Byte, jbyte, "B")                    \
+    F(addr, Int, jint, "I")                     \
+    F(val, Int, jint, "I")                      \
+    F(rw_flag, Byte, jbyte, "B")
+
+#define FM_JNI_FIELD_MEMBER(name, Type, ctype, sig)                         \
+    jfieldID name##_id = NULL;                                              \
+    ctype get_##name(JNIEnv* env, jobject obj) const {                      \
+        return env->Get##Type##Field(obj, name##_id);                       \
+    }                                                                       \
+    void set_##name(JNIEnv* env, jobject obj, ctype value) const {          \
+        env->Set##Type##Field(obj, name##_id, value);                       \
+    }
+
+#define FM_JNI_FIELD_RESOLVE(name, Type, ctype, sig)                        \
+    name##_id = env->GetFieldID(local, #name, sig);                         \
+    if (name##_id == NULL) {                                                \
+        env->ExceptionClear();                                              \
+        env->DeleteLocalRef(local);                                         \
+        return false;                                                       \
+    }
+
+#define FM_JNI_CLASS(Struct, FIELDS)                                        \
+    struct Struct {                                                         \
+        jclass clazz = NULL; /* global ref, NULL until resolved */          \
+        FIELDS(FM_JNI_FIELD_MEMBER)                                         \
+        bool resolve(JNIEnv* env, const char* className) {                  \
+            jclass local = env->FindClass(className);                       \
+            if (local == NULL) {                                            \
+                env->ExceptionClear();                                      \
+                return false;                                               \
+            }                                                               \
+            FIELDS(FM_JNI_FIELD_RESOLVE)                                    \
+            clazz = (jclass)env->NewGlobalRef(local);                       \
+            env->DeleteLocalRef(local);                                     \
+            return clazz != NULL;                                           \
+        }                                                                   \
+        bool isResolved() const { return clazz != NULL; }                   \
+    };
+
+FM_JNI_CLASS(FmSeekCriteriaIds, FM_SEEK_CRITERIA_FIELDS)
+FM_JNI_CLASS(FmAudioThresholdIds, FM_AUDIO_THRESHOLD_FIELDS)
+FM_JNI_CLASS(FmRegCtlIds, FM_REG_CTL_FIELDS)
+
+#endif
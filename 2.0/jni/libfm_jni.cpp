@@ -15,8 +15,19 @@
  */
 
 #include <jni.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define FMR_LOG_LEVEL FMR_LOG_LEVEL_INFO
 #include "../default/fmr.h"
+#include "../default/SignalMonitor.h"
 #include "jni_helper.h"
+#include "jni_ids.h"
 
 #ifdef LOG_TAG
 #undef LOG_TAG
@@ -26,6 +37,101 @@
 static int g_idx = -1;
 extern struct fmr_ds fmr_data;
 
+// sampling while powered up, shared by all quality readers of this process
+static SignalMonitor g_signal([](SignalSample* sample) {
+    return FMR_get_signal(g_idx, &sample->rssi, &sample->snr, &sample->bler) == 0;
+});
+
+// parameter classes, resolved in JNI_OnLoad
+static const char *classPathNameSeekCriteria = "com/android/fmradio/FmNative$FmSeekCriteriaParms";
+static const char *classPathNameAudioThreshold = "com/android/fmradio/FmNative$FmAudioThresholdParms";
+static const char *classPathNameRegCtl = "com/android/fmradio/FmNative$FmRegCtlParms";
+static FmSeekCriteriaIds g_seekCriteriaIds;
+static FmAudioThresholdIds g_audioThresholdIds;
+static FmRegCtlIds g_regCtlIds;
+
+// static callbacks of FmNative, each optional: the natives using one work without it
+static JavaVM *g_vm = NULL;
+static jclass g_nativeClass = NULL;
+static jmethodID g_onScanProgress = NULL;   // (int count)
+static jmethodID g_onRdsEvents = NULL;      // (int events, ByteBuffer bundle)
+
+// one reader of the driver rds block at a time: Java polling or the listener
+static std::mutex g_rdsMut;
+static void stopRdsListener();
+
+/*
+ * Layout of the direct ByteBuffer filled by readRdsBundle, in native byte order
+ * (the Java side sets ByteOrder.nativeOrder()). Bump FM_RDS_BUNDLE_VERSION whenever an
+ * offset changes.
+ *
+ *   0  u16  version
+ *   2  u16  events     RDS_EVENT_* raised by this read, 0 when there was none
+ *   4  u16  pi
+ *   6  u8   pty
+ *   7  u8   flags      FM_RDS_BUNDLE_FLAG_*
+ *   8  i32  rssi       -1 when unknown
+ *  12  i32  bler       -1 when unknown
+ *  16  u8   ps_len
+ *  17  u8   rt_len
+ *  18  u8   af_num
+ *  19  u8   reserved
+ *  20  u8   ps[8]      printable, see COM_change_string
+ *  28  u8   rt[64]     printable
+ *  92  u16  af[25]     10kHz units, Eg. 8750
+ * 142  u16  reserved
+ * 144       total size, the least capacity of the buffer
+ */
+#define FM_RDS_BUNDLE_VERSION 1
+#define FM_RDS_BUNDLE_FLAG_TP     0x01
+#define FM_RDS_BUNDLE_FLAG_TA     0x02
+#define FM_RDS_BUNDLE_FLAG_MUSIC  0x04
+#define FM_RDS_BUNDLE_FLAG_STEREO 0x08
+#define FM_RDS_BUNDLE_AF_MAX 25
+
+struct fm_rds_bundle {
+    uint16_t version;
+    uint16_t events;
+    uint16_t pi;
+    uint8_t pty;
+    uint8_t flags;
+    int32_t rssi;
+    int32_t bler;
+    uint8_t ps_len;
+    uint8_t rt_len;
+    uint8_t af_num;
+    uint8_t reserved;
+    uint8_t ps[8];
+    uint8_t rt[64];
+    uint16_t af[FM_RDS_BUNDLE_AF_MAX];
+    uint16_t reserved2;
+};
+
+static_assert(offsetof(fm_rds_bundle, rssi) == 8, "rds bundle layout changed");
+static_assert(offsetof(fm_rds_bundle, ps) == 20, "rds bundle layout changed");
+static_assert(offsetof(fm_rds_bundle, rt) == 28, "rds bundle layout changed");
+static_assert(offsetof(fm_rds_bundle, af) == 92, "rds bundle layout changed");
+static_assert(sizeof(fm_rds_bundle) == 144, "rds bundle layout changed");
+
+// same rule as COM_change_string, on a copy so the driver block stays untouched
+static void copyPrintable(uint8_t *dst, const uint8_t *src, int len)
+{
+    for (int i = 0; i < len; i++) {
+        dst[i] = (src[i] >= 0x20 && src[i] <= 0x7E) ? src[i] : ' ';
+    }
+}
+
+// AF list of the tuned station, method A or B alike
+static int copyAfList(const RDSData_Struct &rds, uint16_t *af, int max)
+{
+    int num = rds.AF_Data.AF_Num;
+    num = num < 0 ? 0 : (num > max ? max : num);
+    for (int i = 0; i < num; i++) {
+        af[i] = (uint16_t)rds.AF_Data.AF[1][i];
+    }
+    return num;
+}
+
 jboolean nativeOpenDev(JNIEnv *env, jobject thiz)
 {
     (void) env;
@@ -44,6 +150,8 @@ jboolean nativeCloseDev(JNIEnv *env, jobject thiz)
 	(void) thiz;
     int ret = 0;
 
+    stopRdsListener();
+    g_signal.stop();
     ret = FMR_close_dev(g_idx);
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
@@ -60,6 +168,9 @@ jboolean nativePowerUp(JNIEnv *env, jobject thiz, jfloat freq)
     LOGI("%s, [freq=%d]\n", __func__, (int)freq);
     tmp_freq = (int)(freq * 10);        //Eg, 87.5 * 10 --> 875
     ret = FMR_pwr_up(g_idx, tmp_freq);
+    if (ret == 0) {
+        g_signal.start();
+    }
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
     return ret?JNI_FALSE:JNI_TRUE;
@@ -71,6 +182,8 @@ jboolean nativePowerDown(JNIEnv *env, jobject thiz, jint type)
 	(void) thiz;
     int ret = 0;
 
+    stopRdsListener();
+    g_signal.stop();
     ret = FMR_pwr_down(g_idx, type);
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
@@ -85,6 +198,7 @@ jboolean nativeTune(JNIEnv *env, jobject thiz, jfloat freq)
     int tmp_freq;
     tmp_freq = (int)(freq * 100);        //Eg, 87.5 * 100 --> 8750
     ret = FMR_tune(g_idx, tmp_freq);
+    g_signal.invalidate();
 
     LOGD("%s, [ret=%d]\n", __func__, ret);
     return ret?JNI_FALSE:JNI_TRUE;
@@ -106,7 +220,9 @@ jfloat nativeSeek(JNIEnv *env, jobject thiz, jfloat freq, jboolean isUp) //jbool
     }
     LOGD("%s, [mute] [ret=%d]\n", __func__, ret);
 
+    g_signal.pause();
     ret = FMR_seek(g_idx, tmp_freq, (int)isUp, &ret_freq, 10);
+    g_signal.resume();
     if (ret) {
         ret_freq = tmp_freq; //seek error, so use original freq
     }
@@ -128,6 +244,7 @@ jshortArray nativeAutoScan(JNIEnv *env, jobject thiz,  jint startFreq)
     int ScanTBL[FM_SCAN_CH_SIZE_MAX];
 
     LOGI("%s, [tbl=%p]\n", __func__, ScanTBL);
+    g_signal.pause();
     FMR_Pre_Search(g_idx);
     ret = FMR_scan(g_idx, ScanTBL, &chl_cnt, startFreq, 10);
     if (ret < 0) {
@@ -136,8 +253,13 @@ jshortArray nativeAutoScan(JNIEnv *env, jobject thiz,  jint startFreq)
         goto out;
     }
     if (chl_cnt > 0) {
+        // the table is int, narrow each channel instead of reinterpreting it
+        jshort channels[FM_SCAN_CH_SIZE_MAX];
+        for (int i = 0; i < chl_cnt; i++) {
+            channels[i] = (jshort)ScanTBL[i];
+        }
         scanChlarray = env->NewShortArray(chl_cnt);
-        env->SetShortArrayRegion(scanChlarray, 0, chl_cnt, (const jshort*)&ScanTBL[0]);
+        env->SetShortArrayRegion(scanChlarray, 0, chl_cnt, channels);
     } else {
         LOGE("cnt error, [cnt=%d]\n", chl_cnt);
         scanChlarray = NULL;
@@ -150,10 +272,102 @@ jshortArray nativeAutoScan(JNIEnv *env, jobject thiz,  jint startFreq)
     }
 
 out:
+    g_signal.resume();
     LOGD("%s, [cnt=%d] [ret=%d]\n", __func__, chl_cnt, ret);
     return scanChlarray;
 }
 
+/*
+ * A streaming scan writes { i32 freq (10kHz, Eg. 8750), i32 rssi } per station into
+ * the direct buffer, in native byte order, and reports the count so far to
+ * FmNative.onScanProgress every batch stations.
+ */
+struct fm_scan_stream {
+    JNIEnv *env;
+    jint *entries;
+    int capacity;   // in stations
+    int batch;
+    int count;
+    int reported;
+};
+
+static int onScanStation(void *cookie, int freq, int rssi)
+{
+    fm_scan_stream *stream = (fm_scan_stream *)cookie;
+
+    stream->entries[2 * stream->count] = freq;
+    stream->entries[2 * stream->count + 1] = rssi;
+    stream->count++;
+
+    if (g_onScanProgress != NULL && stream->count - stream->reported >= stream->batch) {
+        stream->env->CallStaticVoidMethod(g_nativeClass, g_onScanProgress, stream->count);
+        stream->reported = stream->count;
+        if (stream->env->ExceptionCheck()) {
+            stream->env->ExceptionDescribe();
+            stream->env->ExceptionClear();
+            return 1;
+        }
+    }
+    // a full buffer ends the scan, like a full table does
+    return stream->count >= stream->capacity ? 1 : 0;
+}
+
+/******************************************
+ * Scans [startFreq, endFreq] (10kHz, 0: band edge), streaming stations into buffer.
+ * stopScan cancels it, stations found so far stay in the buffer.
+ *Return Value:
+ *      stations written to buffer
+ *      -1: buffer not direct or too small, or scan error
+ ******************************************/
+jint nativeScanStream(JNIEnv *env, jobject thiz, jint startFreq, jint endFreq,
+                      jobject buffer, jint batch)
+{
+	(void) thiz;
+    int ret = 0;
+    int num = 0;
+    fm_scan_stream stream;
+    jlong capacity = 0;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.entries = (jint *)env->GetDirectBufferAddress(buffer);
+    capacity = env->GetDirectBufferCapacity(buffer) / (jlong)(2 * sizeof(jint));
+    if (stream.entries == NULL || capacity <= 0) {
+        LOGE("%s, need a direct buffer of at least one station\n", __func__);
+        return -1;
+    }
+    stream.env = env;
+    stream.capacity = capacity > CQI_CH_NUM_MAX ? CQI_CH_NUM_MAX : (int)capacity;
+    stream.batch = batch > 0 ? batch : 1;
+
+    LOGI("%s, [%d, %d] [capacity=%d] [batch=%d]\n", __func__, startFreq, endFreq,
+         stream.capacity, stream.batch);
+    g_signal.pause();
+    FMR_Pre_Search(g_idx);
+    ret = FMR_scan_stream(g_idx, startFreq, endFreq, 10, onScanStation, &stream, &num);
+    FMR_Restore_Search(g_idx);
+
+    if (fmr_data.scan_stop == fm_true) {
+        FMR_tune(g_idx, fmr_data.cur_freq);
+        LOGI("scan stop!!! [cnt=%d]", stream.count);
+    }
+    // the tail of the last batch
+    if (g_onScanProgress != NULL && stream.count > stream.reported) {
+        env->CallStaticVoidMethod(g_nativeClass, g_onScanProgress, stream.count);
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+    g_signal.resume();
+
+    LOGD("%s, [cnt=%d] [ret=%d]\n", __func__, stream.count, ret);
+    // -1 is the "nothing found" of FMR_seek_Channels, other errors are -ERR_*
+    if (ret < -1 && stream.count == 0) {
+        return -1;
+    }
+    return stream.count;
+}
+
 jshort nativeReadRds(JNIEnv *env, jobject thiz)
 {
     (void) env;
@@ -161,6 +375,7 @@ jshort nativeReadRds(JNIEnv *env, jobject thiz)
     int ret = 0;
     uint16_t status = 0;
 
+    std::lock_guard<std::mutex> lk(g_rdsMut);
     ret = FMR_read_rds_data(g_idx, &status);
 
     if (ret) {
@@ -171,6 +386,209 @@ jshort nativeReadRds(JNIEnv *env, jobject thiz)
     return status;
 }
 
+static void fillRdsBundle(fm_rds_bundle *bundle, uint16_t events);
+
+/******************************************
+ * Reads rds events and fills buffer with everything known of the station,
+ * layout: fm_rds_bundle. Blocks like readRds.
+ *Return Value:
+ *      RDS_EVENT_* of this read, 0 when none
+ *      -1: buffer not direct or too small
+ ******************************************/
+jint nativeReadRdsBundle(JNIEnv *env, jobject thiz, jobject buffer)
+{
+	(void) thiz;
+    int ret = 0;
+    uint16_t status = 0;
+    fm_rds_bundle *bundle = NULL;
+
+    bundle = (fm_rds_bundle *)env->GetDirectBufferAddress(buffer);
+    if (bundle == NULL || env->GetDirectBufferCapacity(buffer) < (jlong)sizeof(*bundle)) {
+        LOGE("%s, need a direct buffer of %zu bytes\n", __func__, sizeof(*bundle));
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lk(g_rdsMut);
+    ret = FMR_read_rds_data(g_idx, &status);
+    if (ret) {
+        status = 0; //there's no event or some error happened
+    }
+    fillRdsBundle(bundle, status);
+
+    return status;
+}
+
+// g_rdsMut held
+static void fillRdsBundle(fm_rds_bundle *bundle, uint16_t events)
+{
+    const RDSData_Struct &rds = fmr_data.rds;
+    SignalSample sample;
+
+    memset(bundle, 0, sizeof(*bundle));
+    bundle->version = FM_RDS_BUNDLE_VERSION;
+    bundle->events = events;
+    bundle->pi = rds.PI;
+    bundle->pty = rds.PTY;
+    if (rds.RDSFlag.TP) bundle->flags |= FM_RDS_BUNDLE_FLAG_TP;
+    if (rds.RDSFlag.TA) bundle->flags |= FM_RDS_BUNDLE_FLAG_TA;
+    if (rds.RDSFlag.Music) bundle->flags |= FM_RDS_BUNDLE_FLAG_MUSIC;
+    if (rds.RDSFlag.Stereo) bundle->flags |= FM_RDS_BUNDLE_FLAG_STEREO;
+
+    bundle->ps_len = sizeof(bundle->ps);
+    copyPrintable(bundle->ps, rds.PS_Data.PS[3], bundle->ps_len);
+    bundle->rt_len = rds.RT_Data.TextLength > sizeof(bundle->rt) ?
+            sizeof(bundle->rt) : rds.RT_Data.TextLength;
+    copyPrintable(bundle->rt, rds.RT_Data.TextData[3], bundle->rt_len);
+    bundle->af_num = copyAfList(rds, bundle->af, FM_RDS_BUNDLE_AF_MAX);
+
+    // the monitor only reads the chip when its newest sample is stale
+    if (g_signal.latest(&sample)) {
+        bundle->rssi = sample.rssi;
+        bundle->bler = sample.bler;
+    } else {
+        bundle->rssi = -1;
+        bundle->bler = -1;
+    }
+}
+
+/*
+ * Rds listener: a native thread, attached to the VM once, that sleeps in poll() while
+ * no rds arrives and pushes events to FmNative.onRdsEvents. Events arriving within
+ * FM_RDS_BATCH_WINDOW_MS of each other go up in one call, with one bundle holding the
+ * latest data of all of them. The bundle buffer is only valid during the upcall.
+ */
+#define FM_RDS_WAIT_SLICE_MS 100    // stopRdsListener waits one slice at most
+#define FM_RDS_BATCH_WINDOW_MS 20
+#define FM_RDS_BATCH_MAX_READS 8
+
+static std::mutex g_listenerMut;    // start/stop, never held across a join
+static std::thread g_rdsThread;
+// cleared to stop the listener; one flag per listener, so a listener detached by a stop
+// from its own upcall can't be revived by the next start
+static std::shared_ptr<std::atomic<bool>> g_rdsRunning;
+static fm_rds_bundle g_rdsBundle;   // listener thread only
+
+// events of one read, 0 when there was none
+static uint16_t readRdsEvents()
+{
+    uint16_t status = 0;
+    if (FMR_read_rds_data(g_idx, &status)) {
+        return 0;
+    }
+    return status;
+}
+
+static void rdsListenerLoop(std::shared_ptr<std::atomic<bool>> running)
+{
+    JNIEnv *env = NULL;
+    jobject buffer = NULL;
+
+    if (g_vm->AttachCurrentThread(&env, NULL) != JNI_OK) {
+        LOGE("%s, attach failed\n", __func__);
+        *running = false;
+        return;
+    }
+    buffer = env->NewDirectByteBuffer(&g_rdsBundle, sizeof(g_rdsBundle));
+
+    while (*running) {
+        int ready = FMR_wait_rds_event(g_idx, FM_RDS_WAIT_SLICE_MS);
+        if (ready == 0) {
+            continue;
+        }
+        if (ready < 0) {
+            // driver can't be polled, fall back to reads at the slice period
+            usleep(FM_RDS_WAIT_SLICE_MS * 1000);
+        }
+
+        uint16_t events = 0;
+        {
+            std::lock_guard<std::mutex> lk(g_rdsMut);
+            events = readRdsEvents();
+        }
+        for (int i = 1; events != 0 && i < FM_RDS_BATCH_MAX_READS; i++) {
+            if (FMR_wait_rds_event(g_idx, FM_RDS_BATCH_WINDOW_MS) <= 0) {
+                break;
+            }
+            std::lock_guard<std::mutex> lk(g_rdsMut);
+            events |= readRdsEvents();
+        }
+        if (events == 0) {
+            if (ready > 0) {
+                // readable with nothing to read: poll isn't implemented, don't spin
+                usleep(FM_RDS_WAIT_SLICE_MS * 1000);
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(g_rdsMut);
+            fillRdsBundle(&g_rdsBundle, events);
+        }
+        env->CallStaticVoidMethod(g_nativeClass, g_onRdsEvents, (jint)events, buffer);
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+
+    env->DeleteLocalRef(buffer);
+    g_vm->DetachCurrentThread();
+    LOGD("%s, exit\n", __func__);
+}
+
+static void stopRdsListener()
+{
+    std::thread listener;
+    {
+        std::lock_guard<std::mutex> lk(g_listenerMut);
+        if (!g_rdsThread.joinable()) {
+            return;
+        }
+        *g_rdsRunning = false;
+        listener = std::move(g_rdsThread);
+    }
+    // called from an onRdsEvents upcall (Eg. power down): the loop ends once it returns
+    if (listener.get_id() == std::this_thread::get_id()) {
+        listener.detach();
+        return;
+    }
+    listener.join();
+}
+
+/******************************************
+ * Starts pushing rds events to FmNative.onRdsEvents, replaces polling readRds.
+ *Return Value:
+ *      JNI_TRUE: running
+ *      JNI_FALSE: FmNative has no onRdsEvents
+ ******************************************/
+jboolean nativeStartRdsListener(JNIEnv *env, jobject thiz)
+{
+    (void) env;
+	(void) thiz;
+
+    if (g_onRdsEvents == NULL) {
+        LOGE("%s, FmNative has no onRdsEvents\n", __func__);
+        return JNI_FALSE;
+    }
+    std::lock_guard<std::mutex> lk(g_listenerMut);
+    if (!g_rdsThread.joinable()) {
+        g_rdsRunning = std::make_shared<std::atomic<bool>>(true);
+        g_rdsThread = std::thread(rdsListenerLoop, g_rdsRunning);
+    }
+    LOGD("%s\n", __func__);
+    return JNI_TRUE;
+}
+
+jboolean nativeStopRdsListener(JNIEnv *env, jobject thiz)
+{
+    (void) env;
+	(void) thiz;
+
+    stopRdsListener();
+    LOGD("%s\n", __func__);
+    return JNI_TRUE;
+}
+
 jbyteArray nativeGetPs(JNIEnv *env, jobject thiz)
 {
 	(void) thiz;
@@ -194,45 +612,74 @@ jint nativeGetBler(JNIEnv *env, jobject thiz)
 {
     (void) env;
 	(void) thiz;
-    int ret = 0;
-    int bler = -1;
+    SignalSample sample;
 
-    ret = FMR_get_bler(g_idx, &bler);
-    if (ret) {
-        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
     }
-    LOGD("%s, [bler=%d] [ret=%d]\n", __func__, bler, ret);
-    return bler;
+    return sample.bler;
 }
 
 jint nativeGetRssi(JNIEnv *env, jobject thiz)
 {
     (void) env;
 	(void) thiz;
-    int ret = 0;
-    int rssi = -1;
+    SignalSample sample;
 
-    ret = FMR_get_rssi(g_idx, &rssi);
-    if (ret) {
-        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
     }
-    LOGD("%s, [rssi=%d] [ret=%d]\n", __func__, rssi, ret);
-    return rssi;
+    return sample.rssi;
 }
 
 jint nativeGetSnr(JNIEnv *env, jobject thiz)
 {
     (void) env;
 	(void) thiz;
-    int ret = 0;
-    int snr = -1;
+    SignalSample sample;
 
-    ret = FMR_get_snr(g_idx, &snr);
+    if (!g_signal.latest(&sample)) {
+        LOGE("%s, error\n", __func__);
+        return -1;
+    }
+    return sample.snr;
+}
+
+/*
+ * @CriticalNative getters for signal meters: static, primitive only, no JNIEnv nor
+ * jclass. They return the newest sample of the monitor, at most one period old while
+ * powered up, and never go to the chip, so they can't block.
+ */
+static jint criticalGetRssi()
+{
+    SignalSample sample;
+    return g_signal.newest(&sample) ? sample.rssi : -1;
+}
+
+static jint criticalGetSnr()
+{
+    SignalSample sample;
+    return g_signal.newest(&sample) ? sample.snr : -1;
+}
+
+static jint criticalGetBler()
+{
+    SignalSample sample;
+    return g_signal.newest(&sample) ? sample.bler : -1;
+}
+
+// @FastNative: a short ioctl, JNIEnv and jclass kept by the calling convention
+static jint fastSetMute(JNIEnv *env, jclass clazz, jboolean mute)
+{
+    (void) env;
+    (void) clazz;
+    int ret = FMR_set_mute(g_idx, (int)mute);
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
     }
-    LOGD("%s, [snr=%d] [ret=%d]\n", __func__, snr, ret);
-    return snr;
+    return ret?JNI_FALSE:JNI_TRUE;
 }
 
 jint nativeReadRegParm(JNIEnv *env, jobject thiz, jobject para)
@@ -240,22 +687,26 @@ jint nativeReadRegParm(JNIEnv *env, jobject thiz, jobject para)
 	(void) thiz;
     int ret = 0;
     fm_reg_ctl_parm fcp;
-    JNIHelper helper(env); //////
+    const FmRegCtlIds &ids = g_regCtlIds;
     memset(&fcp, 0, sizeof(fcp));
 
-    fcp.rw_flag = helper.getByteField(para,"rw_flag"); /////
-    fcp.addr = helper.getIntField(para,"addr");  ///////
-    fcp.err = helper.getByteField(para,"err"); ///////
+    if (!ids.isResolved()) {
+        LOGE("%s, FmRegCtlParms not resolved\n", __func__);
+        return -1;
+    }
+    fcp.rw_flag = ids.get_rw_flag(env, para);
+    fcp.addr = ids.get_addr(env, para);
+    fcp.err = ids.get_err(env, para);
     ret = FMR_rw_reg(g_idx, &fcp);
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
         return -1;
     }
 
-    helper.setByteField(para,"err",fcp.err); //////
-    helper.setIntField(para,"addr",fcp.addr); ///////
-    helper.setIntField(para,"val",fcp.val); ////////
-    helper.setByteField(para,"rw_flag",fcp.rw_flag); //////
+    ids.set_err(env, para, fcp.err);
+    ids.set_addr(env, para, fcp.addr);
+    ids.set_val(env, para, fcp.val);
+    ids.set_rw_flag(env, para, fcp.rw_flag);
     LOGD("%s, [ret=%d][err=%d] [addr=0x%8x] [val=%d] [rw_flag=%d]\n", \
         __func__, ret, fcp.err,fcp.addr,fcp.val,fcp.rw_flag);
 
@@ -267,13 +718,17 @@ jint nativeWriteRegParm(JNIEnv *env, jobject thiz, jobject para)
 	(void) thiz;
     int ret = 0;
     fm_reg_ctl_parm fcp;
-    JNIHelper helper(env);
+    const FmRegCtlIds &ids = g_regCtlIds;
     memset(&fcp, 0, sizeof(fcp));
 
-    fcp.err = helper.getByteField(para,"err");
-    fcp.addr = helper.getIntField(para,"addr");
-    fcp.val = helper.getIntField(para,"val");
-    fcp.rw_flag = helper.getByteField(para,"rw_flag");
+    if (!ids.isResolved()) {
+        LOGE("%s, FmRegCtlParms not resolved\n", __func__);
+        return -1;
+    }
+    fcp.err = ids.get_err(env, para);
+    fcp.addr = ids.get_addr(env, para);
+    fcp.val = ids.get_val(env, para);
+    fcp.rw_flag = ids.get_rw_flag(env, para);
 
     LOGD("%s, [err=%d] [addr=0x%8x] [val=%d] [rw_flag=%d]\n",\
         __func__, fcp.err, fcp.addr, fcp.val, fcp.rw_flag);
@@ -292,20 +747,24 @@ jint nativeGetTuneParm(JNIEnv *env, jobject thiz, jobject para)
 	(void) thiz;
     int ret = 0;
     fm_seek_criteria_parm parm;
-    JNIHelper helper(env);
+    const FmSeekCriteriaIds &ids = g_seekCriteriaIds;
     memset(&parm, 0, sizeof(parm));
 
+    if (!ids.isResolved()) {
+        LOGE("%s, FmSeekCriteriaParms not resolved\n", __func__);
+        return -1;
+    }
     ret = FMR_get_tune(g_idx, &parm);
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
         return -1;
     }
 
-    helper.setIntField(para,"rssi_th",parm.rssi_th);
-    helper.setByteField(para,"snr_th",parm.snr_th);
-    helper.setIntField(para,"freq_offset_th",parm.freq_offset_th);
-    helper.setIntField(para,"pilot_power_th",parm.pilot_power_th);
-    helper.setIntField(para,"noise_power_th",parm.noise_power_th);
+    ids.set_rssi_th(env, para, parm.rssi_th);
+    ids.set_snr_th(env, para, parm.snr_th);
+    ids.set_freq_offset_th(env, para, parm.freq_offset_th);
+    ids.set_pilot_power_th(env, para, parm.pilot_power_th);
+    ids.set_noise_power_th(env, para, parm.noise_power_th);
     LOGD("%s, [ret=%d]\n", __func__, ret);
 
     return ret;
@@ -315,15 +774,19 @@ jint nativeSetTuneParm(JNIEnv *env, jobject thiz, jobject para)
 {
 	(void) thiz;
     int ret = 0;
-    JNIHelper helper(env);
+    const FmSeekCriteriaIds &ids = g_seekCriteriaIds;
     fm_seek_criteria_parm parm;
     memset(&parm, 0, sizeof(parm));
 
-    parm.rssi_th = (unsigned char)helper.getIntField(para,"rssi_th");
-    parm.snr_th = helper.getByteField(para,"snr_th");
-    parm.freq_offset_th = helper.getIntField(para,"freq_offset_th");
-    parm.pilot_power_th = helper.getIntField(para,"pilot_power_th");
-    parm.noise_power_th = helper.getIntField(para,"noise_power_th");
+    if (!ids.isResolved()) {
+        LOGE("%s, FmSeekCriteriaParms not resolved\n", __func__);
+        return -1;
+    }
+    parm.rssi_th = (unsigned char)ids.get_rssi_th(env, para);
+    parm.snr_th = ids.get_snr_th(env, para);
+    parm.freq_offset_th = ids.get_freq_offset_th(env, para);
+    parm.pilot_power_th = ids.get_pilot_power_th(env, para);
+    parm.noise_power_th = ids.get_noise_power_th(env, para);
     ret = FMR_set_tune(g_idx, &parm);
 
     if (ret) {
@@ -339,20 +802,24 @@ jint nativeGetAudioParm(JNIEnv *env, jobject thiz,jobject para)
 	(void) thiz;
     int ret = 0;
     fm_audio_threshold_parm parm;
-    JNIHelper helper(env);
+    const FmAudioThresholdIds &ids = g_audioThresholdIds;
     memset(&parm, 0, sizeof(parm));
 
+    if (!ids.isResolved()) {
+        LOGE("%s, FmAudioThresholdParms not resolved\n", __func__);
+        return -1;
+    }
     ret = FMR_get_audio(g_idx, &parm);
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
         return -1;
     }
 
-    helper.setIntField(para,"hbound",parm.hbound);
-    helper.setIntField(para,"lbound",parm.lbound);
-    helper.setIntField(para,"power_th",parm.power_th);
-    helper.setByteField(para,"phyt",parm.phyt);
-    helper.setByteField(para,"snr_th",parm.snr_th);
+    ids.set_hbound(env, para, parm.hbound);
+    ids.set_lbound(env, para, parm.lbound);
+    ids.set_power_th(env, para, parm.power_th);
+    ids.set_phyt(env, para, parm.phyt);
+    ids.set_snr_th(env, para, parm.snr_th);
     LOGD("%s, [ret=%d]\n", __func__, ret);
 
     return ret;
@@ -362,15 +829,19 @@ jint nativeSetAudioParm(JNIEnv *env, jobject thiz, jobject para)
 {
 	(void) thiz;
     int ret = 0;
-    JNIHelper helper(env);
+    const FmAudioThresholdIds &ids = g_audioThresholdIds;
     fm_audio_threshold_parm parm;
     memset(&parm, 0, sizeof(parm));
 
-    parm.hbound = helper.getIntField(para,"hbound");
-    parm.lbound = helper.getIntField(para,"lbound");
-    parm.power_th = helper.getIntField(para,"power_th");
-    parm.phyt = helper.getByteField(para,"phyt");
-    parm.snr_th = helper.getByteField(para,"snr_th");
+    if (!ids.isResolved()) {
+        LOGE("%s, FmAudioThresholdParms not resolved\n", __func__);
+        return -1;
+    }
+    parm.hbound = ids.get_hbound(env, para);
+    parm.lbound = ids.get_lbound(env, para);
+    parm.power_th = ids.get_power_th(env, para);
+    parm.phyt = ids.get_phyt(env, para);
+    parm.snr_th = ids.get_snr_th(env, para);
 
     ret = FMR_set_audio(g_idx, &parm);
     if (ret) {
@@ -407,7 +878,10 @@ jshort nativeActiveAf(JNIEnv *env, jobject thiz)
     int ret = 0;
     jshort ret_freq = 0;
 
+    // the driver checks and may switch to another channel
+    g_signal.pause();
     ret = FMR_active_af(g_idx, (uint16_t*)&ret_freq);
+    g_signal.resume();
     if (ret) {
         LOGE("%s, error, [ret=%d]\n", __func__, ret);
         return 0;
@@ -419,19 +893,19 @@ jshort nativeActiveAf(JNIEnv *env, jobject thiz)
 jshortArray nativeGetAFList(JNIEnv *env, jobject thiz)
 {
 	(void) thiz;
-    int ret = 0;
     jshortArray AFList;
-    char *af = NULL;
+    uint16_t af[FM_RDS_BUNDLE_AF_MAX];
     int af_len = 0;
 
-    //ret = FMR_get_af(g_idx, &af, &af_len); // If need, we should implemate this API
-    if (ret) {
-        LOGE("%s, error, [ret=%d]\n", __func__, ret);
+    // kept up to date by readRds/readRdsBundle
+    af_len = copyAfList(fmr_data.rds, af, FM_RDS_BUNDLE_AF_MAX);
+    AFList = env->NewShortArray(af_len);
+    if (AFList == NULL) {
+        LOGE("%s, error, [len=%d]\n", __func__, af_len);
         return NULL;
     }
-    AFList = env->NewShortArray(af_len);
     env->SetShortArrayRegion(AFList, 0, af_len, (const jshort*)af);
-    LOGD("%s, [ret=%d]\n", __func__, ret);
+    LOGD("%s, [len=%d]\n", __func__, af_len);
     return AFList;
 }
 
@@ -580,6 +1054,33 @@ static JNINativeMethod methodsRx[] = {
     {"writeRegParm",     "(Lcom/android/fmradio/FmNative$FmRegCtlParms;)I", (void*)nativeWriteRegParm  },
 };
 
+/*
+ * Methods an older FmNative may not declare, registered one by one so a missing one
+ * doesn't fail the others.
+ */
+static JNINativeMethod optionalMethodsRx[] = {
+    {"readRdsBundle", "(Ljava/nio/ByteBuffer;)I", (void*)nativeReadRdsBundle },
+    {"getAFList",     "()[S", (void*)nativeGetAFList },
+    {"scanStream",    "(IILjava/nio/ByteBuffer;I)I", (void*)nativeScanStream },
+    {"startRdsListener", "()Z", (void*)nativeStartRdsListener },
+    {"stopRdsListener",  "()Z", (void*)nativeStopRdsListener },
+};
+
+/*
+ * Hot methods under their own names, declared in FmNative as
+ *   @CriticalNative static native int getRssiCritical();  (same for Snr, Bler)
+ *   @FastNative static native int setMuteFast(boolean mute);
+ * The runtime picks the calling convention from the annotation, so an implementation
+ * here must match it: no JNIEnv/jclass for critical ones. readRds blocks in the driver
+ * and has no such variant, the rds listener replaces polling it.
+ */
+static JNINativeMethod hotMethodsRx[] = {
+    {"getRssiCritical", "()I", (void*)criticalGetRssi },
+    {"getSnrCritical",  "()I", (void*)criticalGetSnr },
+    {"getBlerCritical", "()I", (void*)criticalGetBler },
+    {"setMuteFast",     "(Z)I", (void*)fastSetMute },
+};
+
 /*
  * Register several native methods for one class.
  */
@@ -599,9 +1100,13 @@ static jint registerNativeMethods(JNIEnv* env, const char* className,
     }
     if (env->RegisterNatives(clazz, gMethods, numMethods) < 0) {
         LOGE("RegisterNatives failed for '%s'", className);
+        // NoSuchMethodError of an undeclared method, the caller decides if it's fatal
+        env->ExceptionClear();
+        env->DeleteLocalRef(clazz);
         return JNI_FALSE;
     }
 
+    env->DeleteLocalRef(clazz);
     LOGD("%s, success\n", __func__);
     return JNI_TRUE;
 }
@@ -619,11 +1124,60 @@ static jint registerNatives(JNIEnv* env)
         sizeof(methodsRx) / sizeof(methodsRx[0]))) {
         ret = JNI_TRUE;
     }
+    if (ret == JNI_TRUE) {
+        for (size_t i = 0; i < sizeof(optionalMethodsRx) / sizeof(optionalMethodsRx[0]); i++) {
+            if (!registerNativeMethods(env, classPathNameRx, &optionalMethodsRx[i], 1)) {
+                LOGW("%s, %s not declared, skipped\n", __func__, optionalMethodsRx[i].name);
+            }
+        }
+        for (size_t i = 0; i < sizeof(hotMethodsRx) / sizeof(hotMethodsRx[0]); i++) {
+            if (!registerNativeMethods(env, classPathNameRx, &hotMethodsRx[i], 1)) {
+                LOGW("%s, %s not declared, skipped\n", __func__, hotMethodsRx[i].name);
+            }
+        }
+    }
 
     LOGD("%s, done\n", __func__);
     return ret;
 }
 
+/*
+ * Resolves field IDs of the parameter classes and the callbacks of FmNative. A class
+ * the app doesn't ship only disables the natives taking it, the others keep working.
+ */
+static void resolveIds(JNIEnv* env)
+{
+    if (!g_seekCriteriaIds.resolve(env, classPathNameSeekCriteria)) {
+        LOGW("unable to resolve '%s'", classPathNameSeekCriteria);
+    }
+    if (!g_audioThresholdIds.resolve(env, classPathNameAudioThreshold)) {
+        LOGW("unable to resolve '%s'", classPathNameAudioThreshold);
+    }
+    if (!g_regCtlIds.resolve(env, classPathNameRegCtl)) {
+        LOGW("unable to resolve '%s'", classPathNameRegCtl);
+    }
+
+    jclass local = env->FindClass(classPathNameRx);
+    if (local == NULL) {
+        env->ExceptionClear();
+        return;
+    }
+    g_nativeClass = (jclass)env->NewGlobalRef(local);
+    env->DeleteLocalRef(local);
+
+    g_onScanProgress = env->GetStaticMethodID(g_nativeClass, "onScanProgress", "(I)V");
+    if (g_onScanProgress == NULL) {
+        env->ExceptionClear();
+        LOGW("no onScanProgress, streaming scans fill the buffer silently");
+    }
+    g_onRdsEvents = env->GetStaticMethodID(g_nativeClass, "onRdsEvents",
+                                           "(ILjava/nio/ByteBuffer;)V");
+    if (g_onRdsEvents == NULL) {
+        env->ExceptionClear();
+        LOGW("no onRdsEvents, rds is polled by Java");
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 /*
@@ -650,11 +1204,13 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved)
         goto fail;
     }
     env = uenv.env;
+    g_vm = vm;
 
     if (registerNatives(env) != JNI_TRUE) {
         LOGE("ERROR: registerNatives failed");
         goto fail;
     }
+    resolveIds(env);
 
     if ((g_idx = FMR_init()) < 0) {
         goto fail;
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Every JNIHelper call against a fake JNIEnv that tracks the local references it hands
+ * out: once the objects a call returned are gone, none may be left, and the helper's
+ * FM_JNI_REF_AUDIT counts must pair up.
+ */
+#include "jni.h"
+
+#include "../jni_helper.h"
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct FakeVm {
+    std::set<jobject> refs;   // live local refs
+    int badDeletes = 0;       // deletes of a ref that isn't live
+    uintptr_t next = 0x1000;
+    bool noFields = false;    // GetFieldID/GetStaticFieldID fail
+    jlong longs[4] = {1, 2, 3, 4};
+} gVm;
+
+template <typename T>
+T newRef() {
+    jobject ref = reinterpret_cast<jobject>(gVm.next += 8);
+    gVm.refs.insert(ref);
+    return reinterpret_cast<T>(ref);
+}
+
+jobject fakeNewLocalRef(JNIEnv*, jobject obj) {
+    return obj != NULL ? newRef<jobject>() : NULL;
+}
+
+void fakeDeleteLocalRef(JNIEnv*, jobject obj) {
+    if (obj != NULL && gVm.refs.erase(obj) == 0) gVm.badDeletes++;
+}
+
+jfieldID fakeFieldId(JNIEnv*, jclass, const char*, const char*) {
+    return gVm.noFields ? NULL : reinterpret_cast<jfieldID>(1);
+}
+
+jmethodID fakeMethodId(JNIEnv*, jclass, const char*, const char*) {
+    return reinterpret_cast<jmethodID>(1);
+}
+
+void fillFunctions(JNINativeInterface* fns) {
+    fns->NewLocalRef = fakeNewLocalRef;
+    fns->DeleteLocalRef = fakeDeleteLocalRef;
+    fns->NewGlobalRef = [](JNIEnv*, jobject obj) { return obj; };
+    fns->DeleteGlobalRef = [](JNIEnv*, jobject) {};
+    fns->FindClass = [](JNIEnv*, const char*) { return newRef<jclass>(); };
+    fns->GetObjectClass = [](JNIEnv*, jobject) { return newRef<jclass>(); };
+    fns->ThrowNew = [](JNIEnv*, jclass, const char*) { return 0; };
+    fns->ExceptionCheck = [](JNIEnv*) -> jboolean { return JNI_FALSE; };
+    fns->ExceptionDescribe = [](JNIEnv*) {};
+    fns->ExceptionClear = [](JNIEnv*) {};
+
+    fns->GetFieldID = fakeFieldId;
+    fns->GetStaticFieldID = fakeFieldId;
+    fns->GetMethodID = fakeMethodId;
+    fns->GetStaticMethodID = fakeMethodId;
+    fns->GetObjectField = [](JNIEnv*, jobject, jfieldID) { return newRef<jobject>(); };
+    fns->GetStaticObjectField = [](JNIEnv*, jclass, jfieldID) { return newRef<jobject>(); };
+    fns->GetBooleanField = [](JNIEnv*, jobject, jfieldID) -> jboolean { return JNI_TRUE; };
+    fns->GetByteField = [](JNIEnv*, jobject, jfieldID) -> jbyte { return 1; };
+    fns->GetIntField = [](JNIEnv*, jobject, jfieldID) -> jint { return 1; };
+    fns->GetLongField = [](JNIEnv*, jobject, jfieldID) -> jlong { return 1; };
+    fns->GetStaticLongField = [](JNIEnv*, jclass, jfieldID) -> jlong { return 1; };
+    fns->SetObjectField = [](JNIEnv*, jobject, jfieldID, jobject) {};
+    fns->SetBooleanField = [](JNIEnv*, jobject, jfieldID, jboolean) {};
+    fns->SetByteField = [](JNIEnv*, jobject, jfieldID, jbyte) {};
+    fns->SetIntField = [](JNIEnv*, jobject, jfieldID, jint) {};
+    fns->SetLongField = [](JNIEnv*, jobject, jfieldID, jlong) {};
+    fns->SetStaticObjectField = [](JNIEnv*, jclass, jfieldID, jobject) {};
+    fns->SetStaticLongField = [](JNIEnv*, jclass, jfieldID, jlong) {};
+
+    fns->NewObjectV = [](JNIEnv*, jclass, jmethodID, va_list) { return newRef<jobject>(); };
+    fns->CallStaticVoidMethodV = [](JNIEnv*, jclass, jmethodID, va_list) {};
+    fns->CallStaticBooleanMethodV = [](JNIEnv*, jclass, jmethodID, va_list) -> jboolean {
+        return JNI_TRUE;
+    };
+
+    fns->NewStringUTF = [](JNIEnv*, const char*) { return newRef<jstring>(); };
+    fns->GetArrayLength = [](JNIEnv*, jarray) -> jsize { return 4; };
+    fns->NewObjectArray = [](JNIEnv*, jsize, jclass, jobject) { return newRef<jobjectArray>(); };
+    fns->GetObjectArrayElement = [](JNIEnv*, jobjectArray, jsize) { return newRef<jobject>(); };
+    fns->SetObjectArrayElement = [](JNIEnv*, jobjectArray, jsize, jobject) {};
+    fns->NewByteArray = [](JNIEnv*, jsize) { return newRef<jbyteArray>(); };
+    fns->NewIntArray = [](JNIEnv*, jsize) { return newRef<jintArray>(); };
+    fns->NewLongArray = [](JNIEnv*, jsize) { return newRef<jlongArray>(); };
+    fns->GetLongArrayElements = [](JNIEnv*, jlongArray, jboolean*) { return gVm.longs; };
+    fns->ReleaseLongArrayElements = [](JNIEnv*, jlongArray, jlong*, jint) {};
+    fns->SetByteArrayRegion = [](JNIEnv*, jbyteArray, jsize, jsize, const jbyte*) {};
+    fns->SetIntArrayRegion = [](JNIEnv*, jintArray, jsize, jsize, const jint*) {};
+    fns->SetLongArrayRegion = [](JNIEnv*, jlongArray, jsize, jsize, const jlong*) {};
+}
+
+struct Call {
+    const char* name;
+    std::function<void(JNIHelper&)> run;
+};
+
+class JniHelperTest : public ::testing::Test {
+  protected:
+    JNINativeInterface mFunctions = {};
+    JNIEnv mEnv;
+    jobject mObj = NULL;   // what a native call gets from java
+    jclass mClass = NULL;
+
+    void SetUp() override {
+        gVm = FakeVm();
+        fillFunctions(&mFunctions);
+        mEnv.functions = &mFunctions;
+        mObj = newRef<jobject>();
+        mClass = newRef<jclass>();
+    }
+
+    // one helper per call like a native method: the helper's refs are all gone after it
+    void expectBalanced(const std::vector<Call>& calls) {
+        for (auto&& call : calls) {
+            SCOPED_TRACE(call.name);
+            size_t before = gVm.refs.size();
+            {
+                JNIHelper helper(&mEnv);
+                call.run(helper);
+                EXPECT_EQ(helper.audit().created, helper.audit().deleted);
+            }
+            EXPECT_EQ(before, gVm.refs.size());
+            EXPECT_EQ(0, gVm.badDeletes);
+        }
+    }
+};
+
+}  // namespace
+
+TEST_F(JniHelperTest, FieldAccessLeavesNoRef) {
+    jlongArray longs = newRef<jlongArray>();
+    expectBalanced({
+        {"getBoolField", [&](JNIHelper& h) { h.getBoolField(mObj, "b"); }},
+        {"getIntField", [&](JNIHelper& h) { h.getIntField(mObj, "i"); }},
+        {"getByteField", [&](JNIHelper& h) { h.getByteField(mObj, "y"); }},
+        {"getLongField", [&](JNIHelper& h) { h.getLongField(mObj, "l"); }},
+        {"getLongArrayField", [&](JNIHelper& h) { h.getLongArrayField(mObj, "a", 1); }},
+        {"getStaticLongField", [&](JNIHelper& h) { h.getStaticLongField(mObj, "l"); }},
+        {"getStaticLongArrayField",
+         [&](JNIHelper& h) { h.getStaticLongArrayField(mObj, "a", 1); }},
+        {"setIntField", [&](JNIHelper& h) { h.setIntField(mObj, "i", 1); }},
+        {"setByteField", [&](JNIHelper& h) { h.setByteField(mObj, "y", 1); }},
+        {"setBooleanField", [&](JNIHelper& h) { h.setBooleanField(mObj, "b", JNI_TRUE); }},
+        {"setLongField", [&](JNIHelper& h) { h.setLongField(mObj, "l", 1); }},
+        {"setLongArrayField", [&](JNIHelper& h) { h.setLongArrayField(mObj, "a", longs); }},
+        {"setLongArrayElement", [&](JNIHelper& h) { h.setLongArrayElement(mObj, "a", 1, 5); }},
+        {"setStringField", [&](JNIHelper& h) { h.setStringField(mObj, "s", "fm"); }},
+        {"setObjectField", [&](JNIHelper& h) { h.setObjectField(mObj, "o", "Lx;", mObj); }},
+        {"setStaticLongField", [&](JNIHelper& h) { h.setStaticLongField(mObj, "l", 1); }},
+        {"setStaticLongArrayField",
+         [&](JNIHelper& h) { h.setStaticLongArrayField(mObj, "a", longs); }},
+    });
+}
+
+TEST_F(JniHelperTest, CallsLeaveNoRef) {
+    jarray array = newRef<jarray>();
+    expectBalanced({
+        {"reportEvent", [&](JNIHelper& h) { h.reportEvent(mClass, "on", "(I)V", 1); }},
+        {"callStaticMethod", [&](JNIHelper& h) { h.callStaticMethod(mClass, "is", "()Z"); }},
+        {"getArrayLength", [&](JNIHelper& h) { h.getArrayLength(array); }},
+        {"throwException", [&](JNIHelper& h) { THROW(h, "test"); }},
+    });
+}
+
+// each returns one ref, owned by the JNIObject the caller keeps
+TEST_F(JniHelperTest, ObjectsOwnTheirRef) {
+    expectBalanced({
+        {"getStringField", [&](JNIHelper& h) { auto o = h.getStringField(mObj, "s"); }},
+        {"getObjectField", [&](JNIHelper& h) { auto o = h.getObjectField(mObj, "o", "Lx;"); }},
+        {"getArrayField", [&](JNIHelper& h) { auto o = h.getArrayField(mObj, "a", "[Lx;"); }},
+        {"getObjectArrayField",
+         [&](JNIHelper& h) { auto o = h.getObjectArrayField(mObj, "a", "[Lx;", 0); }},
+        {"createObject", [&](JNIHelper& h) { auto o = h.createObject("x/X"); }},
+        {"createObjectArray", [&](JNIHelper& h) { auto o = h.createObjectArray("x/X", 2); }},
+        {"getObjectArrayElement", [&](JNIHelper& h) {
+             auto array = h.newObjectArray(2, "x/X", NULL);
+             auto o = h.getObjectArrayElement(array, 1);
+         }},
+        {"newByteArray", [&](JNIHelper& h) { auto o = h.newByteArray(4); }},
+        {"newIntArray", [&](JNIHelper& h) { auto o = h.newIntArray(4); }},
+        {"newLongArray", [&](JNIHelper& h) { auto o = h.newLongArray(4); }},
+        {"newStringUTF", [&](JNIHelper& h) { auto o = h.newStringUTF("fm"); }},
+    });
+}
+
+TEST_F(JniHelperTest, MissingFieldsLeaveNoRef) {
+    gVm.noFields = true;
+    expectBalanced({
+        {"getIntField", [&](JNIHelper& h) { h.getIntField(mObj, "i"); }},
+        {"getObjectArrayField",
+         [&](JNIHelper& h) { auto o = h.getObjectArrayField(mObj, "a", "[Lx;", 0); }},
+        {"setLongArrayElement", [&](JNIHelper& h) { h.setLongArrayElement(mObj, "a", 1, 5); }},
+        {"setStringField", [&](JNIHelper& h) { h.setStringField(mObj, "s", "fm"); }},
+    });
+}
+
+TEST_F(JniHelperTest, MoveKeepsOneRef) {
+    size_t before = gVm.refs.size();
+    JNIHelper helper(&mEnv);
+    {
+        JNIObject<jstring> a = helper.newStringUTF("fm");
+        JNIObject<jstring> b(std::move(a));
+        EXPECT_TRUE(a.isNull());
+        EXPECT_EQ(before + 1, gVm.refs.size());
+        a = std::move(b);
+        EXPECT_EQ(before + 1, gVm.refs.size());
+    }
+    EXPECT_EQ(before, gVm.refs.size());
+    EXPECT_EQ(helper.audit().created, helper.audit().deleted);
+}
+
+TEST_F(JniHelperTest, CloneMakesSecondRef) {
+    size_t before = gVm.refs.size();
+    JNIHelper helper(&mEnv);
+    {
+        JNIObject<jstring> a = helper.newStringUTF("fm");
+        JNIObject<jstring> b = a.clone();
+        EXPECT_NE(a.get(), b.get());
+        EXPECT_EQ(before + 2, gVm.refs.size());
+    }
+    EXPECT_EQ(before, gVm.refs.size());
+    EXPECT_EQ(helper.audit().created, helper.audit().deleted);
+}
+
+// a detached ref is the caller's, Eg. returned to java
+TEST_F(JniHelperTest, DetachHandsRefOver) {
+    size_t before = gVm.refs.size();
+    JNIHelper helper(&mEnv);
+    jstring s = helper.newStringUTF("fm").detach();
+    EXPECT_EQ(before + 1, gVm.refs.size());
+    EXPECT_EQ(helper.audit().created, helper.audit().deleted);
+    fakeDeleteLocalRef(&mEnv, s);
+    EXPECT_EQ(0, gVm.badDeletes);
+}